@@ -0,0 +1,87 @@
+#include "adaptive.h"
+
+// Weight of the newest sample in the smoothed throughput
+#define RATE_SMOOTHING 0.3
+// Fraction of the measured throughput playback may use, leaving slack for timing
+#define RATE_HEADROOM  0.8
+// A finer level must fit with this much to spare before quality steps back up
+#define RECOVER_MARGIN 1.25
+
+// Quality ladder, best first: frame stride and downsampling factor
+static const struct { int stride, factor; } ladder[] = {
+    { 1, 1 }, { 2, 1 },
+    { 1, 2 }, { 2, 2 },
+    { 1, 3 }, { 2, 3 },
+    { 1, 4 }, { 2, 4 },
+};
+#define LADDER_LEN ((int)(sizeof(ladder) / sizeof(ladder[0])))
+
+void adaptive_init(adaptive_t *a, double fps) {
+    a->fps    = fps > 0 ? fps : 1;
+    a->rate   = 0;
+    a->window_bytes   = 0;
+    a->window_seconds = 0;
+    a->window_writes  = 0;
+    a->level  = 0;
+    a->stride = ladder[0].stride;
+    a->factor = ladder[0].factor;
+}
+
+void adaptive_record(adaptive_t *a, size_t bytes, double seconds) {
+    a->window_bytes   += bytes;
+    a->window_seconds += seconds;
+    if (++a->window_writes < a->fps / 4 || a->window_bytes == 0) return;
+
+    // Floor the time so a window that never blocked reads as very fast
+    double busy   = a->window_seconds > 1e-3 ? a->window_seconds : 1e-3;
+    double sample = (double)a->window_bytes / busy;
+    a->window_bytes   = 0;
+    a->window_seconds = 0;
+    a->window_writes  = 0;
+
+    a->rate = a->rate == 0 ? sample : a->rate + RATE_SMOOTHING * (sample - a->rate);
+}
+
+// Bytes per second a level sends for frames of `frame_bytes` bytes
+static double level_cost(int level, size_t frame_bytes, double fps) {
+    int f = ladder[level].factor;
+    return (double)frame_bytes / (f * f) * fps / ladder[level].stride;
+}
+
+void adaptive_update(adaptive_t *a, size_t frame_bytes) {
+    if (a->rate == 0) return; // nothing measured yet
+
+    double budget = a->rate * RATE_HEADROOM;
+
+    // Degrade until the stream fits
+    while (a->level < LADDER_LEN - 1 && level_cost(a->level, frame_bytes, a->fps) > budget) {
+        a->level++;
+    }
+    // Recover one level at a time once throughput comes back
+    if (a->level > 0 &&
+        level_cost(a->level - 1, frame_bytes, a->fps) * RECOVER_MARGIN < budget) {
+        a->level--;
+    }
+    a->stride = ladder[a->level].stride;
+    a->factor = ladder[a->level].factor;
+}
+
+size_t adaptive_downsample(const char *src, size_t len, int factor, char *dst) {
+    size_t out = 0;
+    size_t line_start = 0;
+    int line = 0;
+
+    while (line_start < len) {
+        // Find the end of this line
+        size_t end = line_start;
+        while (end < len && src[end] != '\n') end++;
+
+        if (line % factor == 0) {
+            for (size_t i = line_start; i < end; i += (size_t)factor) dst[out++] = src[i];
+            if (end < len) dst[out++] = '\n';
+        }
+        line++;
+        line_start = end + 1;
+    }
+    return out;
+}
@@ -0,0 +1,39 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stddef.h>
+
+// Tracks how fast stdout actually absorbs output and picks how much of the
+// video to send so that playback keeps up with the frame rate. Quality is
+// lowered one step at a time along a fixed ladder: first every other frame
+// is skipped, then the resolution is halved, and so on.
+typedef struct {
+    double fps;
+    double rate;    // smoothed bytes per second accepted by stdout
+    size_t window_bytes;    // bytes written in the current sampling window
+    double window_seconds;  // time spent blocked writing them
+    int    window_writes;
+    int    level;   // current rung of the quality ladder (0 = full quality)
+    int    stride;  // draw every `stride`-th frame at this level
+    int    factor;  // keep every `factor`-th row and column at this level
+} adaptive_t;
+
+// Start at full quality with no throughput measured yet
+void adaptive_init(adaptive_t *a, double fps);
+
+// Record that a write of `bytes` took `seconds` to be accepted. Writes are
+// pooled over a quarter second of frames, since most land in a kernel buffer
+// without blocking and only the occasional one waits for the reader.
+void adaptive_record(adaptive_t *a, size_t bytes, double seconds);
+
+// Pick the quality level for frames of about `frame_bytes` bytes and update
+// `stride` and `factor`. Steps down as far as needed when over budget, but
+// back up only one level at a time and only when the finer level fits with
+// headroom, so quality does not oscillate.
+void adaptive_update(adaptive_t *a, size_t frame_bytes);
+
+// Keep every `factor`-th column of every `factor`-th line of a newline
+// separated frame. `dst` must hold `len` bytes. Returns the bytes written.
+size_t adaptive_downsample(const char *src, size_t len, int factor, char *dst);
+
+#endif // ADAPTIVE_H
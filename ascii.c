@@ -0,0 +1,323 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "ascii.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Classic 8x8 Bayer index matrix (values 0..63). Thresholds depend only on
+// the cell position, so identical input always yields identical glyphs and
+// unchanged regions stay byte-identical from one frame to the next.
+static const uint8_t bayer8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+struct render_band {
+    const gray_image_t *img;
+    char               *out;
+    int                 row_begin;
+    int                 row_end;
+    dither_t            dither;
+    ascii_history_t    *history;
+};
+
+int ascii_parse_dither(const char *name, dither_t *out) {
+    if (!name || !out) return -1;
+    if (strcmp(name, "none") == 0)  { *out = DITHER_NONE;  return 0; }
+    if (strcmp(name, "bayer") == 0) { *out = DITHER_BAYER; return 0; }
+    return -1;
+}
+
+// Read the next whitespace-delimited header integer, skipping '#' comments
+static int pgm_read_int(FILE *f, int *value) {
+    int c;
+    for (;;) {
+        c = fgetc(f);
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = fgetc(f);
+        } else if (!isspace(c)) {
+            break;
+        }
+    }
+    if (c == EOF || !isdigit(c)) return -1;
+
+    long v = 0;
+    while (c != EOF && isdigit(c)) {
+        v = v * 10 + (c - '0');
+        if (v > 1 << 20) return -1; // absurd dimension, refuse
+        c = fgetc(f);
+    }
+    // exactly one whitespace byte separates the header from the raster,
+    // which the loop above has already consumed
+    *value = (int)v;
+    return 0;
+}
+
+int gray_image_load_pgm(const char *path, gray_image_t *img) {
+    if (!path || !img) return -1;
+    memset(img, 0, sizeof(*img));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    int maxval;
+    if (fgetc(f) != 'P' || fgetc(f) != '5' ||
+        pgm_read_int(f, &img->width) != 0 ||
+        pgm_read_int(f, &img->height) != 0 ||
+        pgm_read_int(f, &maxval) != 0 ||
+        img->width <= 0 || img->height <= 0 || maxval <= 0 || maxval > 255) {
+        fclose(f);
+        return -1;
+    }
+
+    size_t n = (size_t)img->width * (size_t)img->height;
+    img->stride = img->width;
+    img->pixels = malloc(n);
+    if (!img->pixels || fread(img->pixels, 1, n, f) != n) {
+        fclose(f);
+        gray_image_free(img);
+        return -1;
+    }
+    fclose(f);
+
+    // Normalize to the full 0..255 range if the producer used a smaller one
+    if (maxval != 255) {
+        for (size_t i = 0; i < n; i++) {
+            unsigned v = img->pixels[i] > maxval ? (unsigned)maxval : img->pixels[i];
+            img->pixels[i] = (uint8_t)((v * 255u + (unsigned)maxval / 2) / (unsigned)maxval);
+        }
+    }
+    return 0;
+}
+
+void gray_image_free(gray_image_t *img) {
+    if (!img) return;
+    free(img->pixels);
+    img->pixels = NULL;
+    img->width = img->height = img->stride = 0;
+}
+
+int ascii_cols(const gray_image_t *img) {
+    return img->width;
+}
+
+int ascii_rows(const gray_image_t *img) {
+    return (img->height + 1) / 2;
+}
+
+size_t ascii_frame_size(const gray_image_t *img) {
+    return (size_t)ascii_rows(img) * (size_t)(ascii_cols(img) + 1);
+}
+
+// Glyph index for a cell's luma; `threshold` is the cell's Bayer matrix entry
+static inline unsigned quantize(unsigned luma, unsigned threshold, dither_t dither) {
+    // Split luma * levels into a glyph index and a remainder in [0, 255);
+    // the remainder decides whether to round up
+    unsigned scaled = luma * (unsigned)(ASCII_RAMP_LEN - 1);
+    unsigned glyph = scaled / 255u;
+    unsigned frac = scaled % 255u;
+
+    if (dither == DITHER_BAYER) {
+        // Round up when frac/255 exceeds (b + 0.5) / 64
+        return glyph + (frac * 128u > (2u * threshold + 1u) * 255u);
+    }
+    return glyph + (frac >= 128u);
+}
+
+struct ascii_history {
+    int      margin;
+    int      cols;
+    int      rows;
+    uint8_t *glyphs;  // glyph index of every cell in the previous frame
+    bool     primed;  // whether `glyphs` holds a previous frame
+    uint8_t  lo[64][ASCII_RAMP_LEN];  // lowest luma of glyph g at threshold t,
+    uint8_t  hi[64][ASCII_RAMP_LEN];  // and highest (lo > hi if none maps to it)
+};
+
+ascii_history_t *ascii_history_create(int margin, dither_t dither) {
+    ascii_history_t *h = calloc(1, sizeof(*h));
+    if (!h) return NULL;
+    h->margin = margin;
+
+    // quantize() is monotonic in luma, so every glyph covers one luma range
+    // per threshold
+    memset(h->lo, 255, sizeof(h->lo));
+    for (unsigned t = 0; t < 64; t++) {
+        for (unsigned luma = 0; luma < 256; luma++) {
+            unsigned g = quantize(luma, t, dither);
+            if (luma < h->lo[t][g]) h->lo[t][g] = (uint8_t)luma;
+            h->hi[t][g] = (uint8_t)luma;
+        }
+    }
+    return h;
+}
+
+void ascii_history_destroy(ascii_history_t *h) {
+    if (!h) return;
+    free(h->glyphs);
+    free(h);
+}
+
+// Size the history for `img`; a frame of another size starts over.
+// Returns 0, or -1 if there is no memory for it.
+static int history_prepare(ascii_history_t *h, const gray_image_t *img) {
+    int cols = ascii_cols(img), rows = ascii_rows(img);
+    if (h->glyphs && h->cols == cols && h->rows == rows) return 0;
+    free(h->glyphs);
+    h->glyphs = malloc((size_t)cols * (size_t)rows);
+    h->cols   = cols;
+    h->rows   = rows;
+    h->primed = false;
+    return h->glyphs ? 0 : -1;
+}
+
+// Render one line of cells, holding back the glyph changes that stay within
+// the margin of the previous frame's glyphs, and remember it for the next frame
+static void render_line_stable(const uint8_t *top, const uint8_t *bot, const uint8_t *thresholds,
+                               char *line, uint8_t *prev, int cols, dither_t dither,
+                               const ascii_history_t *h) {
+    // No luma is within a margin of -256 of anything: the first frame keeps nothing
+    const int margin = h->primed ? h->margin : -256;
+    for (int c = 0; c < cols; c++) {
+        unsigned luma = (top[c] + bot[c] + 1u) >> 1;
+        unsigned t = thresholds[c & 7];
+        unsigned glyph = quantize(luma, t, dither);
+
+        // Keep the previous glyph while its luma range is within the margin
+        // (an unchanged glyph passes the test as well). Branch-free: which
+        // way it goes is as unpredictable as the noise it suppresses.
+        unsigned p = prev[c];
+        int l = (int)luma;
+        unsigned keep = (unsigned)((l + margin >= h->lo[t][p]) & (l - margin <= h->hi[t][p]));
+        glyph ^= (glyph ^ p) & (0u - keep);
+        prev[c] = (uint8_t)glyph;
+        line[c] = ASCII_RAMP[glyph];
+    }
+}
+
+int ascii_history_resume(ascii_history_t *h, const char *text, size_t len) {
+    const char *nl = memchr(text, '\n', len);
+    if (!nl || nl == text) return -1;
+    size_t cols = (size_t)(nl - text);
+    if (len % (cols + 1) != 0) return -1;
+    gray_image_t shape = { .width = (int)cols, .height = (int)(len / (cols + 1) * 2) };
+    if (history_prepare(h, &shape) != 0) return -1;
+
+    h->primed = false;
+    for (int r = 0; r < h->rows; r++) {
+        const char *line = text + (size_t)r * (cols + 1);
+        for (size_t c = 0; c < cols; c++) {
+            const char *glyph = line[c] ? memchr(ASCII_RAMP, line[c], ASCII_RAMP_LEN) : NULL;
+            if (!glyph || line[cols] != '\n') return -1;
+            h->glyphs[(size_t)r * cols + c] = (uint8_t)(glyph - ASCII_RAMP);
+        }
+    }
+    h->primed = true;
+    return 0;
+}
+
+void ascii_render_rows(const gray_image_t *img, char *out,
+                       int row_begin, int row_end, dither_t dither,
+                       ascii_history_t *history) {
+    const int cols = ascii_cols(img);
+
+    for (int r = row_begin; r < row_end; r++) {
+        const uint8_t *top = img->pixels + (size_t)(2 * r) * (size_t)img->stride;
+        const uint8_t *bot = (2 * r + 1 < img->height) ? top + img->stride : top;
+        const uint8_t *thresholds = bayer8[r & 7];
+        char *line = out + (size_t)r * (size_t)(cols + 1);
+        line[cols] = '\n';
+
+        if (history) {
+            render_line_stable(top, bot, thresholds, line,
+                               history->glyphs + (size_t)r * (size_t)cols, cols, dither, history);
+            continue;
+        }
+        for (int c = 0; c < cols; c++) {
+            // Fold the two pixel rows covered by this cell into one luma value
+            unsigned luma = (top[c] + bot[c] + 1u) >> 1;
+            line[c] = ASCII_RAMP[quantize(luma, thresholds[c & 7], dither)];
+        }
+    }
+}
+
+static void *render_band_thread(void *arg) {
+    struct render_band *b = arg;
+    ascii_render_rows(b->img, b->out, b->row_begin, b->row_end, b->dither, b->history);
+    return NULL;
+}
+
+void ascii_render(const gray_image_t *img, char *out,
+                  dither_t dither, int nthreads, ascii_history_t *history) {
+    const int rows = ascii_rows(img);
+
+    if (history && history_prepare(history, img) != 0) {
+        history = NULL;  // render without it rather than fail
+    }
+
+    // Not worth a thread for fewer than a handful of rows per band
+    if (nthreads > rows / 8) nthreads = rows / 8;
+    if (nthreads <= 1) {
+        ascii_render_rows(img, out, 0, rows, dither, history);
+        if (history) history->primed = true;
+        return;
+    }
+
+    pthread_t tids[nthreads];
+    bool threaded[nthreads];
+    struct render_band bands[nthreads];
+
+    for (int i = 0; i < nthreads; i++) {
+        bands[i] = (struct render_band){
+            .img       = img,
+            .out       = out,
+            .row_begin = rows * i / nthreads,
+            .row_end   = rows * (i + 1) / nthreads,
+            .dither    = dither,
+            .history   = history,
+        };
+        // Band 0 runs on the calling thread, as does any band whose
+        // thread could not be started
+        threaded[i] = i > 0 &&
+            pthread_create(&tids[i], NULL, render_band_thread, &bands[i]) == 0;
+        if (!threaded[i]) render_band_thread(&bands[i]);
+    }
+    for (int i = 1; i < nthreads; i++) {
+        if (threaded[i]) pthread_join(tids[i], NULL);
+    }
+    if (history) history->primed = true;
+}
+
+int ascii_write_frame(const gray_image_t *img, const char *out_path,
+                      dither_t dither, int nthreads) {
+    size_t size = ascii_frame_size(img);
+    char *buf = malloc(size);
+    if (!buf) return -1;
+    ascii_render(img, buf, dither, nthreads, NULL);
+
+    FILE *f = fopen(out_path, "wb");
+    int ok = f && fwrite(buf, 1, size, f) == size;
+    if (f && fclose(f) != 0) ok = 0;
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+int ascii_convert_file(const char *in_path, const char *out_path,
+                       dither_t dither, int nthreads) {
+    gray_image_t img;
+    if (gray_image_load_pgm(in_path, &img) != 0) return -1;
+
+    int ret = ascii_write_frame(&img, out_path, dither, nthreads);
+    gray_image_free(&img);
+    return ret;
+}
@@ -0,0 +1,82 @@
+#ifndef ASCII_H
+#define ASCII_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Glyph ramp used by the converter, darkest to brightest
+#define ASCII_RAMP        " .:-=+*#%@"
+#define ASCII_RAMP_LEN    (sizeof(ASCII_RAMP) - 1)
+
+// Quantization strategies for mapping luma onto the glyph ramp
+typedef enum {
+    DITHER_NONE,  // plain rounding to the nearest glyph
+    DITHER_BAYER  // 8x8 ordered (Bayer) dither, deterministic per cell
+} dither_t;
+
+// An 8-bit grayscale image, row-major, one byte per pixel. Rows are
+// `stride` bytes apart so decoder-owned planes can be used without a copy.
+typedef struct {
+    int      width;
+    int      height;
+    int      stride;
+    uint8_t *pixels;
+} gray_image_t;
+
+// Temporal stabilization of the glyphs of consecutive frames. Noise and
+// compression artifacts make cells near a glyph threshold flip between two
+// glyphs from frame to frame; a cell instead keeps its previous glyph until
+// its luma moves more than `margin` (in 0..255 luma units) past the edge of
+// that glyph's range.
+typedef struct ascii_history ascii_history_t;
+
+// History for frames rendered with `dither`; returns NULL if out of memory
+ascii_history_t *ascii_history_create(int margin, dither_t dither);
+void ascii_history_destroy(ascii_history_t *h);
+
+// Carry on from a frame rendered earlier, `len` bytes of text as written by
+// ascii_render(), as though it had just been rendered with `h` (a conversion
+// picking up where an interrupted one stopped). Returns 0, or -1 if `text`
+// is not a rendered frame or there is no memory.
+int ascii_history_resume(ascii_history_t *h, const char *text, size_t len);
+
+// Parse a dither mode name ("none" or "bayer"); returns -1 if unknown
+int ascii_parse_dither(const char *name, dither_t *out);
+
+// Load a binary PGM (P5) image; returns 0 on success, -1 on error
+int gray_image_load_pgm(const char *path, gray_image_t *img);
+
+// Release the pixel buffer owned by `img`
+void gray_image_free(gray_image_t *img);
+
+// Character grid produced for an image: one column per pixel and one row
+// per pair of pixel rows, since terminal cells are roughly twice as tall
+// as they are wide
+int ascii_cols(const gray_image_t *img);
+int ascii_rows(const gray_image_t *img);
+
+// Bytes needed for a rendered frame, including one '\n' per row
+size_t ascii_frame_size(const gray_image_t *img);
+
+// Render text rows [row_begin, row_end) of `img` into `out`, which must hold
+// ascii_frame_size(img) bytes. Rows are independent of each other, so bands
+// may be rendered concurrently into the same buffer (and history). `history`
+// may be NULL; otherwise it must have been sized by ascii_render().
+void ascii_render_rows(const gray_image_t *img, char *out,
+                       int row_begin, int row_end, dither_t dither,
+                       ascii_history_t *history);
+
+// Render the whole frame, splitting rows across up to `nthreads` threads.
+// Consecutive frames of a video share a `history` (or pass NULL).
+void ascii_render(const gray_image_t *img, char *out,
+                  dither_t dither, int nthreads, ascii_history_t *history);
+
+// Render `img` and write it as an ASCII text frame; returns 0 or -1
+int ascii_write_frame(const gray_image_t *img, const char *out_path,
+                      dither_t dither, int nthreads);
+
+// Convert a PGM frame on disk into an ASCII text frame; returns 0 or -1
+int ascii_convert_file(const char *in_path, const char *out_path,
+                       dither_t dither, int nthreads);
+
+#endif // ASCII_H
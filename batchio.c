@@ -0,0 +1,291 @@
+#define _GNU_SOURCE
+
+#include "batchio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+enum { REQ_FREE, REQ_QUEUED, REQ_IN_FLIGHT, REQ_DONE };
+
+// Operations of a request, in chain order (low bits of user_data)
+enum { OP_OPEN, OP_TRANSFER, OP_CLOSE, OPS_PER_REQUEST };
+
+struct request {
+    uint64_t tag;
+    int      state;
+    int      remaining;  // completions still to come
+    int      write;
+    size_t   expect;     // bytes a write must transfer
+    ssize_t  result;
+    char     path[PATH_MAX];
+};
+
+struct batch_io {
+    int                  fd;
+    unsigned             depth;
+    struct request      *reqs;
+
+    // Submission queue
+    void                *sq_ring;
+    size_t               sq_ring_size;
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t               sqes_size;
+    unsigned             sq_local_tail;
+    unsigned             to_submit;
+
+    // Completion queue (shares the SQ mapping on current kernels)
+    void                *cq_ring;
+    size_t               cq_ring_size;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+// Every operation used, plus direct descriptors (implied by CQE_SKIP, 5.17+)
+static int supported(int fd, const struct io_uring_params *p) {
+    if (!(p->features & IORING_FEAT_SINGLE_MMAP) || !(p->features & IORING_FEAT_CQE_SKIP)) {
+        return 0;
+    }
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (!probe) return 0;
+
+    int ok = uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    const int ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE };
+    for (size_t i = 0; ok && i < sizeof(ops) / sizeof(ops[0]); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+batch_io_t *batch_io_create(unsigned depth) {
+    if (depth == 0 || getenv("SM_NO_IO_URING")) return NULL;
+
+    batch_io_t *io = calloc(1, sizeof(*io));
+    if (!io) return NULL;
+    io->fd    = -1;
+    io->depth = depth;
+    io->reqs  = calloc(depth, sizeof(*io->reqs));
+
+    struct io_uring_params p = { 0 };
+    if (!io->reqs || (io->fd = uring_setup(depth * OPS_PER_REQUEST, &p)) < 0 ||
+        !supported(io->fd, &p)) {
+        goto fail;
+    }
+
+    // One mapping holds both rings
+    io->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    io->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (io->cq_ring_size > io->sq_ring_size) io->sq_ring_size = io->cq_ring_size;
+    io->sq_ring = mmap(NULL, io->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, io->fd, IORING_OFF_SQ_RING);
+    if (io->sq_ring == MAP_FAILED) {
+        io->sq_ring = NULL;
+        goto fail;
+    }
+    io->cq_ring = io->sq_ring;
+
+    io->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, io->fd, IORING_OFF_SQES);
+    if (io->sqes == MAP_FAILED) {
+        io->sqes = NULL;
+        goto fail;
+    }
+
+    char *sq = io->sq_ring, *cq = io->cq_ring;
+    io->sq_head  = (unsigned *)(sq + p.sq_off.head);
+    io->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    io->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    io->sq_array = (unsigned *)(sq + p.sq_off.array);
+    io->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    io->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    io->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    io->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    io->sq_local_tail = *io->sq_tail;
+
+    // Private descriptor table: request i opens its file into slot i
+    int *slots = malloc(depth * sizeof(int));
+    if (!slots) goto fail;
+    for (unsigned i = 0; i < depth; i++) slots[i] = -1;
+    int rc = uring_register(io->fd, IORING_REGISTER_FILES, slots, depth);
+    free(slots);
+    if (rc != 0) goto fail;
+    return io;
+
+fail:
+    if (io->sqes) munmap(io->sqes, io->sqes_size);
+    if (io->sq_ring) munmap(io->sq_ring, io->sq_ring_size);
+    if (io->fd >= 0) close(io->fd);
+    free(io->reqs);
+    free(io);
+    return NULL;
+}
+
+static struct request *find(const batch_io_t *io, uint64_t tag) {
+    for (unsigned i = 0; i < io->depth; i++) {
+        if (io->reqs[i].state != REQ_FREE && io->reqs[i].tag == tag) return &io->reqs[i];
+    }
+    return NULL;
+}
+
+static struct io_uring_sqe *next_sqe(batch_io_t *io) {
+    unsigned idx = io->sq_local_tail & *io->sq_mask;
+    struct io_uring_sqe *sqe = &io->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    io->sq_array[idx] = idx;
+    io->sq_local_tail++;
+    io->to_submit++;
+    return sqe;
+}
+
+static int queue(batch_io_t *io, uint64_t tag, const char *path, void *buf,
+                 size_t len, int write) {
+    if (!io || find(io, tag) || strlen(path) >= PATH_MAX) return -1;
+
+    unsigned slot = 0;
+    while (slot < io->depth && io->reqs[slot].state != REQ_FREE) slot++;
+    if (slot == io->depth) return -1;
+
+    struct request *r = &io->reqs[slot];
+    *r = (struct request){ .tag = tag, .state = REQ_QUEUED, .remaining = OPS_PER_REQUEST,
+                           .write = write, .expect = len };
+    strcpy(r->path, path);
+
+    // Hard links keep the chain going after a failure, so the close always
+    // runs and the descriptor slot is free again when the request completes
+    uint64_t ud = (uint64_t)slot * OPS_PER_REQUEST;
+    struct io_uring_sqe *sqe = next_sqe(io);
+    sqe->opcode     = IORING_OP_OPENAT;
+    sqe->flags      = IOSQE_IO_HARDLINK;
+    sqe->fd         = AT_FDCWD;
+    sqe->addr       = (uintptr_t)r->path;
+    sqe->len        = write ? 0644 : 0;
+    sqe->open_flags = write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY; // no O_CLOEXEC for direct descriptors
+    sqe->file_index = slot + 1;
+    sqe->user_data  = ud + OP_OPEN;
+
+    sqe = next_sqe(io);
+    sqe->opcode    = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->flags     = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    sqe->fd        = (int)slot;
+    sqe->addr      = (uintptr_t)buf;
+    sqe->len       = (unsigned)len;
+    sqe->off       = 0;
+    sqe->user_data = ud + OP_TRANSFER;
+
+    sqe = next_sqe(io);
+    sqe->opcode     = IORING_OP_CLOSE;
+    sqe->file_index = slot + 1;
+    sqe->user_data  = ud + OP_CLOSE;
+    return 0;
+}
+
+int batch_io_queue_write(batch_io_t *io, uint64_t tag, const char *path,
+                         const void *data, size_t len) {
+    return queue(io, tag, path, (void *)data, len, 1);
+}
+
+int batch_io_queue_read(batch_io_t *io, uint64_t tag, const char *path,
+                        void *buf, size_t cap) {
+    return queue(io, tag, path, buf, cap, 0);
+}
+
+int batch_io_submit(batch_io_t *io) {
+    if (!io) return -1;
+    if (io->to_submit == 0) return 0;
+    __atomic_store_n(io->sq_tail, io->sq_local_tail, __ATOMIC_RELEASE);
+
+    int n;
+    do {
+        n = uring_enter(io->fd, io->to_submit, 0, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return -1;
+
+    io->to_submit -= (unsigned)n;
+    for (unsigned i = 0; i < io->depth; i++) {
+        if (io->reqs[i].state == REQ_QUEUED) io->reqs[i].state = REQ_IN_FLIGHT;
+    }
+    return 0;
+}
+
+// Reap whatever completions are available
+static void reap(batch_io_t *io) {
+    unsigned head = *io->cq_head;
+    unsigned tail = __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &io->cqes[head & *io->cq_mask];
+        struct request *r = &io->reqs[cqe->user_data / OPS_PER_REQUEST];
+        int op = (int)(cqe->user_data % OPS_PER_REQUEST);
+
+        if (op == OP_OPEN && cqe->res < 0) {
+            r->result = cqe->res;
+        } else if (op == OP_TRANSFER && r->result >= 0) {
+            r->result = cqe->res;
+            if (r->write && cqe->res >= 0 && (size_t)cqe->res != r->expect) r->result = -EIO;
+        }
+        if (--r->remaining == 0) r->state = REQ_DONE;
+    }
+    __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+}
+
+int batch_io_pending(const batch_io_t *io, uint64_t tag) {
+    const struct request *r = io ? find(io, tag) : NULL;
+    return r && r->state != REQ_DONE;
+}
+
+ssize_t batch_io_wait(batch_io_t *io, uint64_t tag) {
+    struct request *r = io ? find(io, tag) : NULL;
+    if (!r) return -ENOENT;
+    if (r->state == REQ_QUEUED && batch_io_submit(io) != 0) return -EIO;
+
+    reap(io);
+    while (r->state != REQ_DONE) {
+        if (uring_enter(io->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            return -errno;
+        }
+        reap(io);
+    }
+    ssize_t result = r->result;
+    r->state = REQ_FREE;
+    return result;
+}
+
+int batch_io_drain(batch_io_t *io) {
+    if (!io) return 0;
+    int failed = 0;
+    for (unsigned i = 0; i < io->depth; i++) {
+        if (io->reqs[i].state != REQ_FREE && batch_io_wait(io, io->reqs[i].tag) < 0) failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+void batch_io_destroy(batch_io_t *io) {
+    if (!io) return;
+    batch_io_drain(io);
+    munmap(io->sqes, io->sqes_size);
+    munmap(io->sq_ring, io->sq_ring_size);
+    close(io->fd);
+    free(io->reqs);
+    free(io);
+}
@@ -0,0 +1,50 @@
+#ifndef BATCHIO_H
+#define BATCHIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Batched whole-file reads and writes over io_uring.
+//
+// Each request opens a file, reads or writes it, and closes it again as one
+// chain of linked operations on a private descriptor table, so many small
+// files cost a single io_uring_enter() per batch rather than three or four
+// syscalls each. Requests are identified by a caller-chosen tag.
+//
+// batch_io_create() returns NULL when the kernel lacks io_uring or any of the
+// operations used (or when SM_NO_IO_URING is set in the environment); callers
+// then fall back to plain syscalls.
+typedef struct batch_io batch_io_t;
+
+// Set up a ring for up to `depth` requests in flight
+batch_io_t *batch_io_create(unsigned depth);
+
+// Wait for everything in flight, then tear the ring down
+void batch_io_destroy(batch_io_t *io);
+
+// Queue creating (or truncating) `path` with the `len` bytes at `data`, which
+// must stay untouched until the request completes. Returns 0, or -1 if `tag`
+// is already in flight or no request slot is free.
+int batch_io_queue_write(batch_io_t *io, uint64_t tag, const char *path,
+                         const void *data, size_t len);
+
+// Queue reading up to `cap` bytes of `path` into `buf`. Returns 0 or -1.
+int batch_io_queue_read(batch_io_t *io, uint64_t tag, const char *path,
+                        void *buf, size_t cap);
+
+// Hand everything queued so far to the kernel in one call
+int batch_io_submit(batch_io_t *io);
+
+// Whether request `tag` is queued or in flight
+int batch_io_pending(const batch_io_t *io, uint64_t tag);
+
+// Wait for request `tag` (submitting it if needed). Returns the bytes read or
+// written, or -errno if opening or the transfer failed. Returns -ENOENT if no
+// such request is in flight.
+ssize_t batch_io_wait(batch_io_t *io, uint64_t tag);
+
+// Wait for every request in flight; returns -1 if any of them failed
+int batch_io_drain(batch_io_t *io);
+
+#endif // BATCHIO_H
@@ -0,0 +1,276 @@
+#define _GNU_SOURCE
+
+#include "daemon.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Finished jobs kept around for STATUS
+#define KEEP_FINISHED 64
+// How long a client may take to send its request
+#define REQUEST_TIMEOUT_MS 1000
+
+struct queue {
+    daemon_job_t *jobs;
+    size_t        count;
+    size_t        cap;
+    int           next_id;
+    int           running;
+};
+
+static const char *const state_names[] = { "queued", "running", "done", "failed" };
+
+const char *daemon_state_name(daemon_state_t state) {
+    return state_names[state];
+}
+
+static int socket_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Bind and listen on `path`, taking over a socket file left by a daemon that
+// is no longer running
+static int listen_on(const char *path) {
+    struct sockaddr_un addr;
+    if (socket_address(path, &addr) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        char reply[8];
+        if (errno != EADDRINUSE || daemon_request(path, "STATUS", reply, sizeof(reply)) == 0) {
+            errno = EADDRINUSE;
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, 16) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+// Drop the oldest finished jobs beyond KEEP_FINISHED
+static void prune(struct queue *q) {
+    size_t finished = 0;
+    for (size_t i = 0; i < q->count; i++) {
+        finished += q->jobs[i].state == JOB_DONE || q->jobs[i].state == JOB_FAILED;
+    }
+    size_t out = 0;
+    for (size_t i = 0; i < q->count; i++) {
+        int done = q->jobs[i].state == JOB_DONE || q->jobs[i].state == JOB_FAILED;
+        if (done && finished > KEEP_FINISHED) {
+            finished--;
+            continue;
+        }
+        q->jobs[out++] = q->jobs[i];
+    }
+    q->count = out;
+}
+
+static int submit(struct queue *q, char *fields, char *reply, size_t len) {
+    // <priority> \t <name> \t <spec>
+    char *name = strchr(fields, '\t');
+    char *spec = name ? strchr(name + 1, '\t') : NULL;
+    if (!spec) {
+        snprintf(reply, len, "ERR malformed request\n");
+        return -1;
+    }
+    *name++ = '\0';
+    *spec++ = '\0';
+    char *end;
+    long priority = strtol(fields, &end, 10);
+    if (*end != '\0' || *name == '\0' || strlen(name) >= sizeof(q->jobs->name) ||
+        strlen(spec) >= DAEMON_SPEC_MAX) {
+        snprintf(reply, len, "ERR malformed request\n");
+        return -1;
+    }
+
+    prune(q);
+    if (q->count == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 16;
+        daemon_job_t *grown = realloc(q->jobs, cap * sizeof(*grown));
+        if (!grown) {
+            snprintf(reply, len, "ERR out of memory\n");
+            return -1;
+        }
+        q->jobs = grown;
+        q->cap  = cap;
+    }
+    daemon_job_t *job = &q->jobs[q->count++];
+    memset(job, 0, sizeof(*job));
+    job->id       = ++q->next_id;
+    job->priority = (int)priority;
+    job->state    = JOB_QUEUED;
+    job->pid      = -1;
+    strcpy(job->name, name);
+    strcpy(job->spec, spec);
+    snprintf(reply, len, "OK %d\n", job->id);
+    return 0;
+}
+
+static void status(const struct queue *q, char *reply, size_t len) {
+    size_t used = 0;
+    reply[0] = '\0';
+    for (size_t i = 0; i < q->count && used < len; i++) {
+        const daemon_job_t *job = &q->jobs[i];
+        used += (size_t)snprintf(reply + used, len - used, "%d\t%s\t%d\t%s\n", job->id,
+                                 daemon_state_name(job->state), job->priority, job->name);
+    }
+}
+
+// Read one request line from a client, answer it and hang up
+static void serve_client(struct queue *q, int fd) {
+    struct timeval tv = { REQUEST_TIMEOUT_MS / 1000, (REQUEST_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char line[DAEMON_SPEC_MAX + 512];
+    size_t used = 0;
+    while (used + 1 < sizeof(line) && !memchr(line, '\n', used)) {
+        ssize_t n = read(fd, line + used, sizeof(line) - 1 - used);
+        if (n <= 0) break;
+        used += (size_t)n;
+    }
+    line[used] = '\0';
+    char *nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+
+    static char reply[64 * 1024];
+    if (strncmp(line, "SUBMIT\t", 7) == 0) {
+        submit(q, line + 7, reply, sizeof(reply));
+    } else if (strcmp(line, "STATUS") == 0) {
+        status(q, reply, sizeof(reply));
+    } else {
+        snprintf(reply, sizeof(reply), "ERR unknown request\n");
+    }
+
+    size_t len = strlen(reply), off = 0;
+    while (off < len) {
+        ssize_t n = send(fd, reply + off, len - off, MSG_NOSIGNAL);
+        if (n <= 0 && errno != EINTR) break;
+        if (n > 0) off += (size_t)n;
+    }
+}
+
+// Collect finished children
+static void reap(struct queue *q) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (size_t i = 0; i < q->count; i++) {
+            if (q->jobs[i].state == JOB_RUNNING && q->jobs[i].pid == pid) {
+                int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+                q->jobs[i].state = ok ? JOB_DONE : JOB_FAILED;
+                q->running--;
+                fprintf(stderr, "Job %d (%s) %s\n", q->jobs[i].id, q->jobs[i].name,
+                        ok ? "done" : "failed");
+            }
+        }
+    }
+}
+
+// Start queued jobs, best first, while there are free slots
+static void schedule(struct queue *q, int limit, int listen_fd, daemon_job_fn run, void *opaque) {
+    while (q->running < limit) {
+        daemon_job_t *best = NULL;
+        for (size_t i = 0; i < q->count; i++) {
+            daemon_job_t *job = &q->jobs[i];
+            if (job->state == JOB_QUEUED && (!best || job->priority > best->priority)) best = job;
+        }
+        if (!best) return;
+
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0) return;  // try again on the next round
+        if (pid == 0) {
+            // Own process group, so that stopping a job stops all of its processes
+            setpgid(0, 0);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            close(listen_fd);
+            _exit(run(best, opaque));
+        }
+        setpgid(pid, pid);  // also here, in case the child has not run yet
+        best->pid   = pid;
+        best->state = JOB_RUNNING;
+        q->running++;
+        fprintf(stderr, "Job %d (%s) started\n", best->id, best->name);
+    }
+}
+
+int daemon_serve(const char *path, int limit, daemon_job_fn run, void *opaque,
+                 volatile sig_atomic_t *stop) {
+    int listen_fd = listen_on(path);
+    if (listen_fd == -1) return -1;
+
+    struct queue q = { 0 };
+    while (!*stop) {
+        struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) > 0 && (pfd.revents & POLLIN)) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd != -1) {
+                serve_client(&q, fd);
+                close(fd);
+            }
+        }
+        reap(&q);
+        schedule(&q, limit, listen_fd, run, opaque);
+    }
+
+    for (size_t i = 0; i < q.count; i++) {
+        if (q.jobs[i].state == JOB_RUNNING) kill(-q.jobs[i].pid, SIGTERM);
+    }
+    for (size_t i = 0; i < q.count; i++) {
+        if (q.jobs[i].state == JOB_RUNNING) waitpid(q.jobs[i].pid, NULL, 0);
+    }
+    close(listen_fd);
+    unlink(path);
+    free(q.jobs);
+    return 0;
+}
+
+int daemon_request(const char *path, const char *request, char *reply, size_t len) {
+    struct sockaddr_un addr;
+    if (len == 0 || socket_address(path, &addr) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t rlen = strlen(request);
+    int ok = write(fd, request, rlen) == (ssize_t)rlen && write(fd, "\n", 1) == 1;
+    size_t used = 0;
+    while (ok && used + 1 < len) {
+        ssize_t n = read(fd, reply + used, len - 1 - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        used += (size_t)n;
+    }
+    reply[used] = '\0';
+    close(fd);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,54 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Background conversion service.
+//
+// The daemon listens on a Unix domain socket and keeps a queue of jobs, of
+// which it runs at most a fixed number at once in child processes, highest
+// priority first and in order of submission within a priority. Every request
+// is one line of tab-separated fields; the daemon replies with zero or more
+// lines and closes the connection:
+//
+//   SUBMIT <priority> <name> <spec>   ->  "OK <id>" or "ERR <reason>"
+//   STATUS                            ->  "<id> <state> <priority> <name>"
+//                                         for every job, oldest first
+//
+// The spec (the rest of the line, tabs included) is opaque to the queue and
+// handed to the job function as is.
+
+#define DAEMON_SPEC_MAX 4096
+
+typedef enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED } daemon_state_t;
+
+typedef struct {
+    int            id;
+    int            priority;
+    daemon_state_t state;
+    pid_t          pid;
+    char           name[256];
+    char           spec[DAEMON_SPEC_MAX];
+} daemon_job_t;
+
+// Body of a job, run in a forked child; returns the child's exit status
+typedef int (*daemon_job_fn)(const daemon_job_t *job, void *opaque);
+
+// Serve requests on the socket at `path` until `*stop` is set, running at most
+// `limit` jobs at once. Running jobs are terminated on the way out. Returns 0,
+// or -1 if the socket could not be set up (errno is EADDRINUSE when another
+// daemon already serves `path`).
+int daemon_serve(const char *path, int limit, daemon_job_fn run, void *opaque,
+                 volatile sig_atomic_t *stop);
+
+// Send one request line (without the newline) to the daemon at `path` and
+// collect its reply in `reply`, NUL-terminated. Returns 0, or -1 if no daemon
+// answered.
+int daemon_request(const char *path, const char *request, char *reply, size_t len);
+
+// Name of a job state as used in STATUS replies ("queued", "running", ...)
+const char *daemon_state_name(daemon_state_t state);
+
+#endif // DAEMON_H
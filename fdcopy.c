@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+
+#include "fdcopy.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// In order of preference; each falls back to the next
+enum { COPY_SPLICE, COPY_SENDFILE, COPY_WRITE };
+
+static const char *const method_names[] = { "splice", "sendfile", "write" };
+
+int fdcopy_init(fdcopy_t *c, int out_fd) {
+    struct stat st;
+    if (getenv("SM_NO_ZEROCOPY") || isatty(out_fd) || fstat(out_fd, &st) != 0) return -1;
+    c->out_fd = out_fd;
+    c->method = S_ISFIFO(st.st_mode) ? COPY_SPLICE : COPY_SENDFILE;
+    return 0;
+}
+
+const char *fdcopy_method(const fdcopy_t *c) {
+    return method_names[c->method];
+}
+
+// Errors meaning this method does not apply here (rather than a failed copy):
+// an output or input the call cannot handle, or a kernel without it
+static int unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EOPNOTSUPP;
+}
+
+// Wait for a non-blocking output to take more
+static void wait_writable(int fd) {
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    poll(&pfd, 1, -1);
+}
+
+static ssize_t copy_once(fdcopy_t *c, int in_fd, off_t *offset, size_t len) {
+    switch (c->method) {
+    case COPY_SPLICE:
+        return splice(in_fd, offset, c->out_fd, NULL, len, SPLICE_F_MORE);
+    case COPY_SENDFILE:
+        return sendfile(c->out_fd, in_fd, offset, len);
+    default: {
+        char buf[64 * 1024];
+        ssize_t n = pread(in_fd, buf, len < sizeof(buf) ? len : sizeof(buf), *offset);
+        if (n <= 0) return n;
+        if (fdcopy_write(c, buf, (size_t)n) != 0) return -1;
+        *offset += n;
+        return n;
+    }
+    }
+}
+
+int fdcopy_send(fdcopy_t *c, int in_fd, off_t offset, size_t len) {
+    while (len > 0) {
+        ssize_t n = copy_once(c, in_fd, &offset, len);
+        if (n > 0) {
+            len -= (size_t)n;
+        } else if (n == 0) {
+            return -1;  // the file is shorter than expected
+        } else if (errno == EAGAIN) {
+            wait_writable(c->out_fd);
+        } else if (c->method != COPY_WRITE && unsupported(errno)) {
+            c->method++;
+        } else if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int fdcopy_write(fdcopy_t *c, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(c->out_fd, p, len);
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                wait_writable(c->out_fd);
+            } else if (errno != EINTR) {
+                return -1;
+            }
+            continue;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef FDCOPY_H
+#define FDCOPY_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Kernel-side copies of file contents to an output that is not a terminal.
+//
+// Frames and recordings already sit in files, so when output goes to a file,
+// pipe or socket their bytes can be moved by the kernel instead of being read
+// into user space and written back out: splice() into pipes and sendfile()
+// into anything else. (copy_file_range() only pays off where it can share
+// extents, which frame-sized unaligned copies never do; measured, sendfile()
+// into a regular file is faster.) A method the kernel refuses falls back to
+// the next one, down to pread()/write(), and the fallback sticks for later
+// copies.
+
+typedef struct {
+    int out_fd;
+    int method;
+} fdcopy_t;
+
+// Prepare copies to `out_fd`. Returns 0, or -1 if `out_fd` is a terminal (or
+// SM_NO_ZEROCOPY is set in the environment), which is better served by the
+// caller's own buffered writes.
+int fdcopy_init(fdcopy_t *c, int out_fd);
+
+// Copy `len` bytes at `offset` in `in_fd` to the output. Returns 0, or -1 if
+// the copy failed or `in_fd` ended early.
+int fdcopy_send(fdcopy_t *c, int in_fd, off_t offset, size_t len);
+
+// Write `len` bytes from memory to the output. Returns 0 or -1.
+int fdcopy_write(fdcopy_t *c, const void *data, size_t len);
+
+// Name of the method in use: "splice", "sendfile" or "write"
+const char *fdcopy_method(const fdcopy_t *c);
+
+#endif // FDCOPY_H
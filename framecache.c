@@ -0,0 +1,269 @@
+#define _DEFAULT_SOURCE
+
+#include "framecache.h"
+#include "batchio.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <linux/limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct slot {
+    int    index;    // frame number, 0 when the slot is empty
+    int    fd;       // kept open so the page cache can be dropped on eviction (-1 for reads)
+    char  *data;
+    size_t len;
+    size_t charged;  // bytes counted against the budget
+    int    owned;    // data is a read buffer rather than a mapping
+    int    pending;  // a queued read is still filling data
+};
+
+struct frame_cache {
+    size_t        budget;
+    size_t        used;
+    size_t        peak;
+    int           read_ahead;
+    int           keep;       // frames stay mapped once shown (frame_cache_keep())
+    int           playhead;
+    int           nslots;
+    struct slot  *slots;
+    frame_path_fn path_for;
+    void         *opaque;
+    batch_io_t   *io;         // queued read-ahead, NULL without io_uring
+    size_t        read_size;  // buffer size for queued reads
+};
+
+#define LOAD_OK       0
+#define LOAD_MISSING -1   // no such frame
+#define LOAD_FULL    -2   // read-ahead would evict something needed sooner
+
+// Stand-in mapping for empty frame files, which cannot be mmap'd
+static char empty_frame[1];
+
+frame_cache_t *frame_cache_create(size_t budget, int read_ahead,
+                                  frame_path_fn path_for, void *opaque) {
+    if (!path_for || read_ahead < 0) return NULL;
+    frame_cache_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->nslots = read_ahead + 1; // the frame on screen plus the read-ahead window
+    c->slots  = calloc((size_t)c->nslots, sizeof(*c->slots));
+    if (!c->slots) {
+        free(c);
+        return NULL;
+    }
+    c->budget     = budget;
+    c->read_ahead = read_ahead;
+    c->path_for   = path_for;
+    c->opaque     = opaque;
+    c->io         = batch_io_create((unsigned)read_ahead);
+    return c;
+}
+
+static void evict(frame_cache_t *c, struct slot *s) {
+    if (s->pending) batch_io_wait(c->io, (uint64_t)s->index); // the kernel still owns the buffer
+    if (s->owned) {
+        free(s->data);
+    } else if (s->data && s->data != empty_frame) {
+        munmap(s->data, s->len);
+    }
+    if (s->fd >= 0) {
+        // Nothing will read this frame again soon; let the kernel drop its pages
+        posix_fadvise(s->fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(s->fd);
+    }
+    c->used -= s->charged;
+    *s = (struct slot){ 0 };
+}
+
+// The least recently needed frame: anything behind the playhead (oldest
+// first), otherwise the one furthest ahead of it. Never picks `keep`.
+static struct slot *pick_victim(frame_cache_t *c, int keep) {
+    struct slot *behind = NULL, *ahead = NULL;
+    for (int i = 0; i < c->nslots; i++) {
+        struct slot *s = &c->slots[i];
+        if (s->index == 0 || s->index == keep) continue;
+        if (s->index < c->playhead) {
+            if (!behind || s->index < behind->index) behind = s;
+        } else if (!ahead || s->index > ahead->index) {
+            ahead = s;
+        }
+    }
+    return behind ? behind : ahead;
+}
+
+static struct slot *find_slot(frame_cache_t *c, int index) {
+    for (int i = 0; i < c->nslots; i++) {
+        if (c->slots[i].index == index) return &c->slots[i];
+    }
+    return NULL;
+}
+
+static struct slot *free_slot(frame_cache_t *c) {
+    return find_slot(c, 0);
+}
+
+// Make room for `len` more bytes, both in bytes and in slots
+static int make_room(frame_cache_t *c, int index, size_t len, int prefetch) {
+    for (;;) {
+        int over_budget = c->budget && c->used + len > c->budget;
+        if (!over_budget && free_slot(c)) return LOAD_OK;
+
+        struct slot *victim = pick_victim(c, c->playhead);
+        if (!victim || (prefetch && victim->index >= c->playhead && victim->index < index)) {
+            // Read-ahead stops rather than displacing a frame needed sooner;
+            // the frame on screen is loaded even if it alone exceeds the budget
+            return prefetch || !free_slot(c) ? LOAD_FULL : LOAD_OK;
+        }
+        evict(c, victim);
+    }
+}
+
+// Queue a read of frame `index` into a buffer sized for the largest frame
+// seen so far; frame_cache_get() collects it
+static int queue_read(frame_cache_t *c, int index, const char *path) {
+    if (make_room(c, index, c->read_size, 1) != LOAD_OK) return LOAD_FULL;
+
+    char *buf = malloc(c->read_size);
+    if (!buf) return LOAD_FULL;
+    if (batch_io_queue_read(c->io, (uint64_t)index, path, buf, c->read_size) != 0) {
+        free(buf);
+        return LOAD_FULL;
+    }
+    struct slot *s = free_slot(c);
+    *s = (struct slot){ .index = index, .fd = -1, .data = buf, .len = c->read_size,
+                        .charged = c->read_size, .owned = 1, .pending = 1 };
+    c->used += c->read_size;
+    if (c->used > c->peak) c->peak = c->used;
+    return LOAD_OK;
+}
+
+static int load(frame_cache_t *c, int index, int prefetch) {
+    char path[PATH_MAX];
+    if (c->path_for(index, path, sizeof(path), c->opaque) != 0) return LOAD_MISSING;
+
+    // Read-ahead goes through the ring once a frame size is known
+    if (prefetch && c->io && c->read_size > 0) return queue_read(c, index, path);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1) return LOAD_MISSING;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return LOAD_MISSING;
+    }
+    size_t len = (size_t)st.st_size;
+
+    if (make_room(c, index, len, prefetch) != LOAD_OK) {
+        close(fd);
+        return LOAD_FULL;
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    char *data = empty_frame;
+    if (len > 0) {
+        data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return LOAD_MISSING;
+        }
+        madvise(data, len, MADV_WILLNEED);
+    }
+    if (c->keep) {
+        // The mapping outlives the descriptor, and a kept video can have more
+        // frames than the process may have files open
+        close(fd);
+        fd = -1;
+    }
+
+    struct slot *s = free_slot(c);
+    *s = (struct slot){ .index = index, .fd = fd, .data = data, .len = len, .charged = len };
+    c->used += len;
+    if (c->used > c->peak) c->peak = c->used;
+
+    // One spare byte tells a complete queued read from a truncated one
+    if (len + 1 > c->read_size) c->read_size = len + 1;
+    return LOAD_OK;
+}
+
+// Collect a queued read; a failed or possibly truncated one is redone directly
+static int finish_read(frame_cache_t *c, struct slot *s) {
+    ssize_t n = batch_io_wait(c->io, (uint64_t)s->index);
+    s->pending = 0;
+    if (n < 0 || (size_t)n >= s->len) {
+        int index = s->index;
+        evict(c, s);
+        return load(c, index, 0);
+    }
+    s->len = (size_t)n;
+    return LOAD_OK;
+}
+
+int frame_cache_get(frame_cache_t *c, int index, frame_view_t *out) {
+    if (!c || !out || index <= 0) return -1;
+    c->playhead = index;
+
+    struct slot *s = find_slot(c, index);
+    if (s && s->pending && finish_read(c, s) != LOAD_OK) return -1;
+    if (!s) {
+        if (load(c, index, 0) != LOAD_OK) return -1;
+    }
+    s = find_slot(c, index);
+    out->data = s->data;
+    out->len  = s->len;
+    return 0;
+}
+
+void frame_cache_prefetch(frame_cache_t *c, int index) {
+    if (!c) return;
+    for (int k = index + 1; k <= index + c->read_ahead; k++) {
+        if (find_slot(c, k)) continue;
+        if (load(c, k, 1) != LOAD_OK) break;
+    }
+    // Hand the whole window to the kernel in one call
+    batch_io_submit(c->io);
+}
+
+void frame_cache_keep(frame_cache_t *c, int frames) {
+    if (!c) return;
+    c->keep = 1;
+    if (frames + 1 <= c->nslots) return;
+    struct slot *grown = realloc(c->slots, (size_t)(frames + 1) * sizeof(*grown));
+    if (!grown) return;
+    memset(grown + c->nslots, 0, (size_t)(frames + 1 - c->nslots) * sizeof(*grown));
+    c->slots  = grown;
+    c->nslots = frames + 1;
+}
+
+size_t frame_cache_peak(const frame_cache_t *c) {
+    return c ? c->peak : 0;
+}
+
+void frame_cache_destroy(frame_cache_t *c) {
+    if (!c) return;
+    for (int i = 0; i < c->nslots; i++) {
+        if (c->slots[i].index != 0) evict(c, &c->slots[i]);
+    }
+    batch_io_destroy(c->io);
+    free(c->slots);
+    free(c);
+}
+
+int parse_size(const char *str, size_t *out) {
+    if (!str || !out || !isdigit((unsigned char)*str)) return -1;
+
+    char *end;
+    unsigned long long v = strtoull(str, &end, 10);
+    switch (toupper((unsigned char)*end)) {
+    case 'G': v <<= 10; /* fall through */
+    case 'M': v <<= 10; /* fall through */
+    case 'K': v <<= 10; end++; break;
+    case '\0': break;
+    default: return -1;
+    }
+    if (*end != '\0' && !(toupper((unsigned char)*end) == 'B' && end[1] == '\0')) return -1;
+    *out = (size_t)v;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <stddef.h>
+
+// Resolve the file holding frame `index` (1-based) into `buf`.
+// Returns 0 if the frame exists, -1 past the end of the video.
+typedef int (*frame_path_fn)(int index, char *buf, size_t len, void *opaque);
+
+// Opaque memory-bounded frame cache used by the player
+typedef struct frame_cache frame_cache_t;
+
+// A frame handed out by the cache; valid until the next cache call
+typedef struct {
+    const char *data;
+    size_t      len;
+} frame_view_t;
+
+// Create a cache holding at most `budget` bytes of mapped frames (0 means
+// no limit) and reading at most `read_ahead` frames beyond the playhead.
+// Frames on demand are mapped; read-ahead is queued through io_uring in
+// one batch per prefetch when the kernel supports it (see batchio.h), and
+// mapped like the rest otherwise.
+frame_cache_t *frame_cache_create(size_t budget, int read_ahead,
+                                  frame_path_fn path_for, void *opaque);
+
+// Map frame `index`, evicting the least recently needed frames to stay
+// within budget. Returns 0 on success, -1 if the frame does not exist.
+int frame_cache_get(frame_cache_t *c, int index, frame_view_t *out);
+
+// Queue frames after `index` for read-ahead, as far as the budget allows
+// without evicting anything that is needed sooner
+void frame_cache_prefetch(frame_cache_t *c, int index);
+
+// Keep up to `frames` frames mapped after they have been shown, as far as
+// the budget allows, for a video that will be played again: frames are then
+// evicted only to stay within budget, and their pages are left in the page
+// cache when they are
+void frame_cache_keep(frame_cache_t *c, int frames);
+
+// Largest number of bytes the cache has had mapped at once
+size_t frame_cache_peak(const frame_cache_t *c);
+
+// Unmap everything and free the cache
+void frame_cache_destroy(frame_cache_t *c);
+
+// Parse a size such as "512K", "64M" or "1G" (plain numbers are bytes);
+// returns 0 on success, -1 if malformed
+int parse_size(const char *str, size_t *out);
+
+#endif // FRAMECACHE_H
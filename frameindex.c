@@ -0,0 +1,391 @@
+#define _DEFAULT_SOURCE
+
+#include "frameindex.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File layout: a header line, then one fixed-width record per frame so the
+// number of frames can be read off the file size:
+//   "<stored frame, 10 digits> <hash, 16 hex digits> <pts in µs, 12 digits>\n"
+// Version 1 records have no timestamp.
+#define INDEX_HEADER     "sm-frame-index 2\n"
+#define INDEX_HEADER_V1  "sm-frame-index 1\n"
+#define INDEX_HEADER_LEN (sizeof(INDEX_HEADER) - 1)
+#define INDEX_RECORD_LEN 41
+#define INDEX_RECORD_V1  28
+// Largest timestamp a record can hold, in microseconds
+#define INDEX_PTS_MAX    999999999999LL
+// Records are written in batches of this many
+#define INDEX_BATCH      16
+
+/* ------------------------------------------------------------------------- */
+/* XXH64                                                                     */
+/* ------------------------------------------------------------------------- */
+
+#define PRIME1 11400714785074694791ULL
+#define PRIME2 14029467366897019727ULL
+#define PRIME3  1609587929392839161ULL
+#define PRIME4  9650029242287828579ULL
+#define PRIME5  2870177450012600261ULL
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+static uint32_t read32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl(acc, 31) * PRIME1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh_round(0, v);
+    return acc * PRIME1 + PRIME4;
+}
+
+uint64_t frame_hash(const void *data, size_t len) {
+    const uint8_t *p = data, *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = PRIME1 + PRIME2, v2 = PRIME2, v3 = 0, v4 = -PRIME1;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = PRIME5;
+    }
+    h += len;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Writer                                                                    */
+/* ------------------------------------------------------------------------- */
+
+struct entry {
+    uint64_t hash;
+    int      frame;  // 0 marks an empty slot
+};
+
+struct frame_index_writer {
+    int           fd;
+    int           count;
+    int           failed;
+    char          batch[INDEX_BATCH * INDEX_RECORD_LEN + 1];
+    int           batched;
+    struct entry *table;  // open addressing, power-of-two capacity
+    size_t        cap;
+    size_t        used;
+};
+
+frame_index_writer_t *frame_index_create(const char *path) {
+    frame_index_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->cap   = 1024;
+    w->table = calloc(w->cap, sizeof(*w->table));
+    w->fd    = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (!w->table || w->fd == -1 ||
+        write(w->fd, INDEX_HEADER, INDEX_HEADER_LEN) != (ssize_t)INDEX_HEADER_LEN) {
+        if (w->fd != -1) close(w->fd);
+        free(w->table);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+static struct entry *probe(struct entry *table, size_t cap, uint64_t hash) {
+    size_t i = (size_t)hash & (cap - 1);
+    while (table[i].frame != 0 && table[i].hash != hash) i = (i + 1) & (cap - 1);
+    return &table[i];
+}
+
+int frame_index_lookup(const frame_index_writer_t *w, uint64_t hash) {
+    if (!w) return 0;
+    return probe(w->table, w->cap, hash)->frame;
+}
+
+static int remember(frame_index_writer_t *w, uint64_t hash, int frame) {
+    if ((w->used + 1) * 2 > w->cap) {
+        size_t cap = w->cap * 2;
+        struct entry *table = calloc(cap, sizeof(*table));
+        if (!table) return -1;
+        for (size_t i = 0; i < w->cap; i++) {
+            if (w->table[i].frame != 0) *probe(table, cap, w->table[i].hash) = w->table[i];
+        }
+        free(w->table);
+        w->table = table;
+        w->cap   = cap;
+    }
+    struct entry *e = probe(w->table, w->cap, hash);
+    if (e->frame == 0) {
+        // Keep the earliest frame for a hash; later ones only differ on a collision
+        *e = (struct entry){ hash, frame };
+        w->used++;
+    }
+    return 0;
+}
+
+static void flush_batch(frame_index_writer_t *w) {
+    ssize_t len = (ssize_t)w->batched * INDEX_RECORD_LEN;
+    if (len > 0 && write(w->fd, w->batch, (size_t)len) != len) w->failed = 1;
+    w->batched = 0;
+}
+
+int frame_index_append(frame_index_writer_t *w, int stored, uint64_t hash, double pts) {
+    if (!w || stored < 1 || stored > w->count + 1) return -1;
+    int frame = ++w->count;
+    if (stored == frame && remember(w, hash, frame) != 0) w->failed = 1;
+
+    double us = pts > 0 ? pts * 1e6 + 0.5 : 0;
+    if (us > INDEX_PTS_MAX) us = INDEX_PTS_MAX;
+    if (snprintf(w->batch + w->batched * INDEX_RECORD_LEN, INDEX_RECORD_LEN + 1,
+                 "%010d %016" PRIx64 " %012lld\n", stored, hash, (long long)us) != INDEX_RECORD_LEN) {
+        w->failed = 1;
+    }
+    if (++w->batched == INDEX_BATCH) flush_batch(w);
+    return w->failed ? -1 : 0;
+}
+
+int frame_index_close(frame_index_writer_t *w) {
+    if (!w) return -1;
+    flush_batch(w);
+    int failed = w->failed;
+    if (close(w->fd) != 0) failed = 1;
+    free(w->table);
+    free(w);
+    return failed ? -1 : 0;
+}
+
+frame_index_writer_t *frame_index_resume(const char *path, frame_index_check_fn check,
+                                         void *opaque) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    char header[INDEX_HEADER_LEN];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, INDEX_HEADER, sizeof(header)) != 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    frame_index_writer_t *w = calloc(1, sizeof(*w));
+    if (!w || !(w->table = calloc(w->cap = 1024, sizeof(*w->table)))) {
+        free(w);
+        fclose(f);
+        return NULL;
+    }
+
+    // Replay the records up to the first one that cannot be kept
+    char record[INDEX_RECORD_LEN + 1];
+    while (fread(record, 1, INDEX_RECORD_LEN, f) == INDEX_RECORD_LEN) {
+        record[INDEX_RECORD_LEN] = '\0';
+        char *end;
+        int stored = atoi(record);
+        uint64_t hash = strtoull(record + 11, &end, 16);
+        int frame = w->count + 1;
+        if (record[INDEX_RECORD_LEN - 1] != '\n' || end != record + 27 ||
+            stored < 1 || stored > frame ||
+            (stored < frame && frame_index_lookup(w, hash) != stored) ||
+            (stored == frame && check && !check(frame, hash, opaque)) ||
+            (stored == frame && remember(w, hash, frame) != 0)) {
+            break;
+        }
+        w->count = frame;
+    }
+    fclose(f);
+
+    w->fd = open(path, O_WRONLY | O_CLOEXEC);
+    off_t keep = (off_t)(INDEX_HEADER_LEN + (size_t)w->count * INDEX_RECORD_LEN);
+    if (w->fd == -1 || ftruncate(w->fd, keep) != 0 || lseek(w->fd, keep, SEEK_SET) != keep) {
+        if (w->fd != -1) close(w->fd);
+        free(w->table);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int frame_index_count(const frame_index_writer_t *w) {
+    return w ? w->count : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reader                                                                    */
+/* ------------------------------------------------------------------------- */
+
+// Record length of the index open on `f` (positioned at the start), or 0 if
+// it is not an index
+static size_t read_header(FILE *f) {
+    char header[INDEX_HEADER_LEN];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)) return 0;
+    if (memcmp(header, INDEX_HEADER, sizeof(header)) == 0) return INDEX_RECORD_LEN;
+    if (memcmp(header, INDEX_HEADER_V1, sizeof(header)) == 0) return INDEX_RECORD_V1;
+    return 0;
+}
+
+int frame_index_written(const char *path) {
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if (!f) return 0;
+    struct stat st;
+    size_t record = read_header(f);
+    int count = 0;
+    if (record && fstat(fileno(f), &st) == 0 && (size_t)st.st_size >= INDEX_HEADER_LEN) {
+        count = (int)(((size_t)st.st_size - INDEX_HEADER_LEN) / record);
+    }
+    fclose(f);
+    return count;
+}
+
+// Allocate the arrays and work out runs once `stored` is filled in
+static int finish_index(frame_index_t *idx) {
+    idx->run       = malloc((size_t)idx->count * sizeof(int));
+    idx->run_frame = malloc((size_t)idx->count * sizeof(int));
+    idx->run_start = malloc((size_t)idx->count * sizeof(int));
+    if (!idx->run || !idx->run_frame || !idx->run_start) return -1;
+
+    idx->unique = 0;
+    idx->runs   = 0;
+    for (int i = 0; i < idx->count; i++) {
+        if (idx->stored[i] == i + 1) idx->unique++;
+        if (i == 0 || idx->stored[i] != idx->stored[i - 1]) {
+            idx->run_frame[idx->runs] = idx->stored[i];
+            idx->run_start[idx->runs] = i + 1;
+            idx->runs++;
+        }
+        idx->run[i] = idx->runs;
+    }
+    return 0;
+}
+
+int frame_index_load(const char *path, frame_index_t *idx) {
+    memset(idx, 0, sizeof(*idx));
+    FILE *f = path ? fopen(path, "rb") : NULL;
+    if (!f) return -1;
+
+    int rc = -1;
+    size_t record_len = read_header(f);
+    idx->count = frame_index_written(path);
+    if (record_len == 0 || idx->count == 0) goto out;
+
+    idx->stored = malloc((size_t)idx->count * sizeof(int));
+    if (record_len == INDEX_RECORD_LEN) idx->pts = malloc((size_t)idx->count * sizeof(double));
+    if (!idx->stored || (record_len == INDEX_RECORD_LEN && !idx->pts)) goto out;
+    for (int i = 0; i < idx->count; i++) {
+        char record[INDEX_RECORD_LEN + 1];
+        if (fread(record, 1, record_len, f) != record_len) goto out;
+        record[record_len] = '\0';
+        // A frame holds its own content or refers to an earlier stored frame
+        int stored = atoi(record);
+        if (stored != i + 1 && (stored < 1 || stored > i || idx->stored[stored - 1] != stored)) {
+            goto out;
+        }
+        idx->stored[i] = stored;
+
+        // Frames are shown in order: a timestamp never goes backwards
+        if (idx->pts) {
+            double pts = strtoll(record + 28, NULL, 10) / 1e6;  // after stored frame and hash
+            idx->pts[i] = i > 0 && pts < idx->pts[i - 1] ? idx->pts[i - 1] : pts;
+        }
+    }
+    rc = finish_index(idx);
+
+out:
+    fclose(f);
+    if (rc != 0) frame_index_free(idx);
+    return rc;
+}
+
+int frame_index_identity(frame_index_t *idx, int count) {
+    memset(idx, 0, sizeof(*idx));
+    if (count <= 0) return -1;
+    idx->count  = count;
+    idx->stored = malloc((size_t)count * sizeof(int));
+    if (!idx->stored) return -1;
+    for (int i = 0; i < count; i++) idx->stored[i] = i + 1;
+    if (finish_index(idx) != 0) {
+        frame_index_free(idx);
+        return -1;
+    }
+    return 0;
+}
+
+double frame_index_time(const frame_index_t *idx, int frame, int fps) {
+    if (!idx->pts || frame < 1 || idx->count == 0) return fps > 0 ? (double)(frame - 1) / fps : 0;
+    if (frame <= idx->count) return idx->pts[frame - 1];
+
+    // Past the end: the last frame is shown for an average frame's time
+    int last = idx->count;
+    double period = last > 1 ? (idx->pts[last - 1] - idx->pts[0]) / (last - 1) : 0;
+    if (period <= 0 && fps > 0) period = 1.0 / fps;
+    return idx->pts[last - 1] + period * (frame - last);
+}
+
+int frame_index_at(const frame_index_t *idx, double t, int fps) {
+    if (!idx->pts) return fps > 0 && t > 0 ? (int)(t * fps) + 1 : 1;
+
+    // Last frame with pts <= t
+    int lo = 1, hi = idx->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (idx->pts[mid - 1] <= t) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+void frame_index_free(frame_index_t *idx) {
+    if (!idx) return;
+    free(idx->stored);
+    free(idx->pts);
+    free(idx->run);
+    free(idx->run_frame);
+    free(idx->run_start);
+    memset(idx, 0, sizeof(*idx));
+}
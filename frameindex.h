@@ -0,0 +1,92 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Content-addressed frame store for a converted video.
+//
+// Frames are identified by a 64-bit hash of their rendered text. A frame
+// whose content was already stored is not written again; the per-video index
+// file records, for every frame in order, which frame's file holds its
+// content (itself if it was new) and its hash.
+//
+// Consecutive frames with the same content form a run, which playback draws
+// once and simply leaves on screen for the rest of the run.
+//
+// Every frame also carries the time it is shown at, in seconds from the start
+// of the video, so that playback can follow a variable frame rate. Indexes
+// written before timestamps existed have none; their frames are shown at
+// regular intervals.
+
+// Loaded index of a video
+typedef struct {
+    int  count;       // frames in the video
+    int  unique;      // frames stored with content of their own
+    int  runs;        // runs of consecutive identical frames
+    int *stored;      // stored[i]: frame whose file holds frame i + 1
+    int *run;         // run[i]: 1-based run that frame i + 1 belongs to
+    int *run_frame;   // run_frame[r]: stored frame drawn for run r + 1
+    int *run_start;   // run_start[r]: first frame of run r + 1
+    double *pts;      // pts[i]: time frame i + 1 is shown at, NULL if not recorded
+} frame_index_t;
+
+typedef struct frame_index_writer frame_index_writer_t;
+
+// 64-bit xxHash (XXH64, seed 0) of a frame's contents
+uint64_t frame_hash(const void *data, size_t len);
+
+// Start a new index at `path`, replacing any existing one. Returns NULL on error.
+frame_index_writer_t *frame_index_create(const char *path);
+
+// The earliest frame added with content hash `hash`, or 0 if there is none
+int frame_index_lookup(const frame_index_writer_t *w, uint64_t hash);
+
+// Record the next frame (frames are added in order, starting at 1), whose
+// content is stored in frame `stored`'s file and which is shown `pts` seconds
+// into the video. Passing the frame's own number marks it as stored, making
+// it a target for later lookups. Records are written in small batches, so
+// progress can be followed from the file size. Returns 0 or -1.
+int frame_index_append(frame_index_writer_t *w, int stored, uint64_t hash, double pts);
+
+// Close the index; returns -1 if any record failed to reach the file
+int frame_index_close(frame_index_writer_t *w);
+
+// Checks a frame of an interrupted index that holds its own content (its
+// file, say); returns nonzero if the frame can be kept
+typedef int (*frame_index_check_fn)(int frame, uint64_t hash, void *opaque);
+
+// Reopen the index at `path`, left behind by an interrupted conversion, to
+// add more frames to it. Its records are kept up to the first stored frame
+// that `check` (if not NULL) rejects, or a record torn by the interruption;
+// that frame and every later one are cut off the file. Returns NULL if there
+// is no index at `path` or it is of an older version.
+frame_index_writer_t *frame_index_resume(const char *path, frame_index_check_fn check,
+                                         void *opaque);
+
+// Frames recorded so far
+int frame_index_count(const frame_index_writer_t *w);
+
+// Frames recorded so far in the index at `path` (0 if there is none yet)
+int frame_index_written(const char *path);
+
+// Load the index at `path`; returns 0 or -1 if missing or malformed
+int frame_index_load(const char *path, frame_index_t *idx);
+
+// Index of `count` frames each stored in its own file (assets converted
+// before deduplication existed)
+int frame_index_identity(frame_index_t *idx, int count);
+
+// Time frame `frame` is shown at: its recorded timestamp, or one frame every
+// 1 / `fps` seconds for indexes without timestamps. Frame count + 1 gives the
+// time the video ends.
+double frame_index_time(const frame_index_t *idx, int frame, int fps);
+
+// The frame on screen `t` seconds into the video: the last one shown at or
+// before `t` (1 before the first frame is due)
+int frame_index_at(const frame_index_t *idx, double t, int fps);
+
+// Release a loaded index
+void frame_index_free(frame_index_t *idx);
+
+#endif // FRAMEINDEX_H
@@ -0,0 +1,242 @@
+#define _DEFAULT_SOURCE
+
+#include "library.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#define FRAME_TAG     "_gray_"
+#define FRAME_TAG_LEN (sizeof(FRAME_TAG) - 1)
+
+// Extensions of numbered frame files: images, ASCII frames, and either of
+// them while being written
+static int frame_extension(const char *ext) {
+    return strcmp(ext, ".pgm") == 0 || strcmp(ext, ".txt") == 0 || strcmp(ext, ".tmp") == 0;
+}
+
+// Video a file belongs to: "<name>_gray_<n>.<ext>" (frames, see
+// frame_extension()) or "<name>.<ext>". Returns 0, or -1 for files that are
+// not part of any video.
+static int video_name(const char *file, char *out) {
+    const char *dot = strrchr(file, '.');
+    if (file[0] == '.' || !dot) return -1;
+
+    size_t len = (size_t)(dot - file);
+    const char *digits = dot;
+    while (digits > file && isdigit((unsigned char)digits[-1])) digits--;
+    if (frame_extension(dot) && digits < dot && (size_t)(digits - file) > FRAME_TAG_LEN &&
+        memcmp(digits - FRAME_TAG_LEN, FRAME_TAG, FRAME_TAG_LEN) == 0) {
+        len = (size_t)(digits - FRAME_TAG_LEN - file);
+    }
+    if (len == 0 || len > NAME_MAX) return -1;
+    memcpy(out, file, len);
+    out[len] = '\0';
+    return 0;
+}
+
+static int listed(const char *name, const char *const *names, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(name, names[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int by_last_used(const void *a, const void *b) {
+    const library_video_t *x = a, *y = b;
+    if (x->last_used != y->last_used) return x->last_used < y->last_used ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+// Find or add the entry for `name`; `hint` is the entry found last, since
+// files of one video tend to come together
+static library_video_t *entry_for(library_video_t **videos, size_t *count, size_t *cap,
+                                  size_t *hint, const char *name) {
+    if (*hint < *count && strcmp((*videos)[*hint].name, name) == 0) return &(*videos)[*hint];
+    for (size_t i = 0; i < *count; i++) {
+        if (strcmp((*videos)[i].name, name) == 0) {
+            *hint = i;
+            return &(*videos)[i];
+        }
+    }
+    if (*count == *cap) {
+        size_t grown_cap = *cap ? *cap * 2 : 16;
+        library_video_t *grown = realloc(*videos, grown_cap * sizeof(*grown));
+        if (!grown) return NULL;
+        *videos = grown;
+        *cap    = grown_cap;
+    }
+    library_video_t *v = &(*videos)[*count];
+    memset(v, 0, sizeof(*v));
+    strcpy(v->name, name);
+    *hint = (*count)++;
+    return v;
+}
+
+// Disk space used by the files in the subdirectory `name` of `dirfd`, and
+// the newest modification time among them and the directory itself. Working
+// directories are flat, so files in deeper directories are not counted.
+static int dir_usage(int dirfd, const char *name, const struct stat *dir_st,
+                     uint64_t *bytes, time_t *mtime) {
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) return -1;
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return -1;
+    }
+
+    *bytes = (uint64_t)dir_st->st_blocks * 512;
+    *mtime = dir_st->st_mtime;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        *bytes += (uint64_t)st.st_blocks * 512;
+        if (st.st_mtime > *mtime) *mtime = st.st_mtime;
+    }
+    closedir(dir);
+    return 0;
+}
+
+int library_scan(const char *const *dirs, size_t ndirs,
+                 library_video_t **videos, size_t *count) {
+    library_video_t *found = NULL;
+    size_t n = 0, cap = 0, hint = 0;
+
+    for (size_t d = 0; d < ndirs; d++) {
+        DIR *dir = opendir(dirs[d]);
+        if (!dir) continue;  // a missing directory holds no videos
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            char name[NAME_MAX + 1];
+            struct stat st;
+            if ((entry->d_type != DT_REG && entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) ||
+                video_name(entry->d_name, name) != 0 ||
+                fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            uint64_t bytes = (uint64_t)st.st_blocks * 512;
+            time_t mtime = st.st_mtime;
+            if (S_ISDIR(st.st_mode)) {
+                if (dir_usage(dirfd(dir), entry->d_name, &st, &bytes, &mtime) != 0) continue;
+            } else if (!S_ISREG(st.st_mode)) {
+                continue;
+            }
+            library_video_t *v = entry_for(&found, &n, &cap, &hint, name);
+            if (!v) {
+                closedir(dir);
+                free(found);
+                return -1;
+            }
+            v->bytes += bytes;
+            if (mtime > v->last_used) v->last_used = mtime;
+        }
+        closedir(dir);
+    }
+
+    if (n > 1) qsort(found, n, sizeof(*found), by_last_used);
+    *videos = found;
+    *count  = n;
+    return 0;
+}
+
+// Remove the subdirectory `name` of `dirfd` with the files in it
+static void remove_dir(int dirfd, const char *name) {
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) return;
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            unlinkat(fd, entry->d_name, 0);
+        }
+    }
+    closedir(dir);
+    unlinkat(dirfd, name, AT_REMOVEDIR);
+}
+
+// Unlink every file and directory of the given videos, one pass over each
+// directory
+static void remove_videos(const char *const *dirs, size_t ndirs,
+                          const library_video_t *videos, size_t count) {
+    for (size_t d = 0; d < ndirs; d++) {
+        DIR *dir = opendir(dirs[d]);
+        if (!dir) continue;
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            char name[NAME_MAX + 1];
+            if (video_name(entry->d_name, name) != 0) continue;
+            for (size_t i = 0; i < count; i++) {
+                if (strcmp(name, videos[i].name) == 0) {
+                    // Linux reports EISDIR (POSIX allows EPERM) for a directory
+                    if (unlinkat(dirfd(dir), entry->d_name, 0) != 0 &&
+                        (errno == EISDIR || errno == EPERM)) {
+                        remove_dir(dirfd(dir), entry->d_name);
+                    }
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+    }
+}
+
+int library_evict(const char *const *dirs, size_t ndirs, uint64_t budget, int incoming,
+                  const char *const *keep, size_t nkeep,
+                  library_video_t **evicted, size_t *nevicted) {
+    *evicted  = NULL;
+    *nevicted = 0;
+
+    library_video_t *videos;
+    size_t count;
+    if (library_scan(dirs, ndirs, &videos, &count) != 0) return -1;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) total += videos[i].bytes;
+    uint64_t reserve = count && incoming > 0 ? total / count * (uint64_t)incoming : 0;
+
+    // Bytes to free: what exceeds the budget, or what the filesystem lacks
+    uint64_t need = total + reserve > budget ? total + reserve - budget : 0;
+    struct statvfs fs;
+    if (ndirs > 0 && statvfs(dirs[0], &fs) == 0) {
+        uint64_t avail = (uint64_t)fs.f_bavail * fs.f_frsize;
+        if (reserve > avail && reserve - avail > need) need = reserve - avail;
+    }
+
+    // Victims move to the front, oldest first
+    size_t victims = 0;
+    uint64_t freed = 0;
+    for (size_t i = 0; i < count && freed < need; i++) {
+        if (listed(videos[i].name, keep, nkeep)) continue;
+        freed += videos[i].bytes;
+        videos[victims++] = videos[i];
+    }
+
+    if (victims == 0) {
+        free(videos);
+        return 0;
+    }
+    remove_videos(dirs, ndirs, videos, victims);
+    *evicted  = videos;
+    *nevicted = victims;
+    return 0;
+}
+
+int library_touch(const char *path) {
+    return utimensat(AT_FDCWD, path, NULL, 0) == 0 ? 0 : -1;
+}
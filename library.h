@@ -0,0 +1,46 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Disk budget for the library of converted videos.
+//
+// A video's files are spread over several asset directories, named
+// "<name>_gray_<n>.<ext>" (frames: .pgm, .txt, or .tmp while written) or
+// "<name>.<ext>" (audio, frame index, anything else). A directory named
+// "<name>.<ext>" (a conversion's working directory) belongs to the video too,
+// with the files in it.
+// A video was last used when the newest of its files was last modified, so
+// touching any one of them (see library_touch()) marks it as just played.
+//
+// Eviction removes whole videos, least recently used first, with one
+// directory pass per asset directory and fd-relative unlinkat() calls.
+
+typedef struct {
+    char     name[NAME_MAX + 1];
+    uint64_t bytes;      // disk space used by all of its files
+    time_t   last_used;  // newest modification time among its files
+} library_video_t;
+
+// List the videos in `dirs`, least recently used first. Returns 0 or -1;
+// the caller frees `*videos`.
+int library_scan(const char *const *dirs, size_t ndirs,
+                 library_video_t **videos, size_t *count);
+
+// Evict least recently used videos, never one named in `keep`, until the
+// library fits in `budget` bytes with room left for `incoming` more videos of
+// its average size, and the filesystem has that room free as well. The
+// evicted videos are returned in `*evicted` (the caller frees it).
+// Returns 0, or -1 if the library could not be read.
+int library_evict(const char *const *dirs, size_t ndirs, uint64_t budget, int incoming,
+                  const char *const *keep, size_t nkeep,
+                  library_video_t **evicted, size_t *nevicted);
+
+// Mark a video as used now by touching `path`, one of its files.
+// Returns 0 or -1.
+int library_touch(const char *path);
+
+#endif // LIBRARY_H
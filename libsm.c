@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include "libsm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void sm_init(sm_context_t *ctx) {
+    *ctx = (sm_context_t){
+        .width  = 900,
+        .fps    = 10,
+        .dither = DITHER_BAYER,
+    };
+}
+
+void sm_reset(sm_context_t *ctx) {
+    ascii_history_destroy(ctx->history);
+    ctx->history = NULL;
+}
+
+void sm_release(sm_context_t *ctx) {
+    sm_reset(ctx);
+    free(ctx->frame);
+    ctx->frame      = NULL;
+    ctx->frame_size = 0;
+}
+
+int sm_resume(sm_context_t *ctx, const char *text, size_t len) {
+    if (!ctx || !text) return SM_ERR_INVALID;
+    if (ctx->stabilize <= 0) return SM_OK;  // frames do not depend on each other
+    if (!ctx->history && !(ctx->history = ascii_history_create(ctx->stabilize, ctx->dither))) {
+        return SM_ERR_NOMEM;
+    }
+    return ascii_history_resume(ctx->history, text, len) == 0 ? SM_OK : SM_ERR_FORMAT;
+}
+
+size_t sm_frame_size(int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    gray_image_t img = { .width = width, .height = height, .stride = width };
+    return ascii_frame_size(&img);
+}
+
+static int render_threads(const sm_context_t *ctx) {
+    if (ctx->threads > 0) return ctx->threads;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu < 1 ? 1 : (int)ncpu;
+}
+
+int sm_render(sm_context_t *ctx, const gray_image_t *img,
+              char *buf, size_t size, size_t *len) {
+    if (!ctx || !img || !img->pixels || img->width <= 0 || img->height <= 0 ||
+        img->stride < img->width || !len) {
+        return SM_ERR_INVALID;
+    }
+    *len = ascii_frame_size(img);
+    if (!buf || size < *len) return SM_ERR_BUFFER;
+
+    if (ctx->stabilize > 0 && !ctx->history) {
+        ctx->history = ascii_history_create(ctx->stabilize, ctx->dither);
+        if (!ctx->history) return SM_ERR_NOMEM;
+    }
+    ascii_render(img, buf, ctx->dither, render_threads(ctx), ctx->history);
+    return SM_OK;
+}
+
+int sm_render_pgm(sm_context_t *ctx, const char *path,
+                  char *buf, size_t size, size_t *len) {
+    if (!path) return SM_ERR_INVALID;
+    if (access(path, R_OK) != 0) return SM_ERR_OPEN;
+    gray_image_t img;
+    if (gray_image_load_pgm(path, &img) != 0) return SM_ERR_FORMAT;
+    int rc = sm_render(ctx, &img, buf, size, len);
+    gray_image_free(&img);
+    return rc;
+}
+
+// Render a decoded frame into the context's own buffer and pass it on
+static int deliver(sm_context_t *ctx, const gray_image_t *img, int index,
+                   double pts, sm_frame_fn on_frame, void *opaque) {
+    size_t len = ascii_frame_size(img);
+    if (len > ctx->frame_size) {
+        char *grown = realloc(ctx->frame, len);
+        if (!grown) return SM_ERR_NOMEM;
+        ctx->frame      = grown;
+        ctx->frame_size = len;
+    }
+    int rc = sm_render(ctx, img, ctx->frame, ctx->frame_size, &len);
+    if (rc != SM_OK) return rc;
+    return on_frame(ctx->frame, len, index, pts, opaque) == 0 ? SM_OK : SM_ERR_STOPPED;
+}
+
+// Read the next image of a PGM stream into `img`, growing its pixel buffer
+// (of `*size` bytes) as needed. Returns 1, 0 at the end of the stream, or an
+// SM_ERR_* code.
+static int read_pgm(FILE *in, gray_image_t *img, size_t *size) {
+    int width, height, maxval;
+    int n = fscanf(in, "P5 %d %d %d", &width, &height, &maxval);
+    if (n == EOF) return 0;
+    if (n != 3 || fgetc(in) == EOF || width <= 0 || height <= 0 || maxval != 255) {
+        return SM_ERR_DECODE;
+    }
+    size_t bytes = (size_t)width * (size_t)height;
+    if (bytes > *size) {
+        uint8_t *grown = realloc(img->pixels, bytes);
+        if (!grown) return SM_ERR_NOMEM;
+        img->pixels = grown;
+        *size       = bytes;
+    }
+    img->width  = width;
+    img->height = height;
+    img->stride = width;
+    return fread(img->pixels, 1, bytes, in) == bytes ? 1 : SM_ERR_DECODE;
+}
+
+// Decode with ffmpeg, which writes the sampled, scaled gray frames to a pipe
+static int convert(sm_context_t *ctx, const char *input, sm_frame_fn on_frame, void *opaque) {
+    const char *ffmpeg = ctx->ffmpeg ? ctx->ffmpeg : "ffmpeg";
+    char start[32], duration[32], vf[96];
+    snprintf(start, sizeof(start), "%.3f", ctx->start);
+    snprintf(duration, sizeof(duration), "%.3f", ctx->duration);
+    snprintf(vf, sizeof(vf), "fps=%d:start_time=0,scale=%d:-1,format=gray", ctx->fps, ctx->width);
+
+    const char *args[24];
+    int n = 0;
+    args[n++] = ffmpeg;
+    args[n++] = "-loglevel";
+    args[n++] = "quiet";
+    args[n++] = "-nostdin";
+    args[n++] = "-ss";
+    args[n++] = start;
+    if (ctx->duration > 0) {
+        args[n++] = "-t";
+        args[n++] = duration;
+    }
+    args[n++] = "-i";
+    args[n++] = input;
+    args[n++] = "-map";
+    args[n++] = "0:v:0";
+    args[n++] = "-an";
+    args[n++] = "-vf";
+    args[n++] = vf;
+    args[n++] = "-c:v";
+    args[n++] = "pgm";
+    args[n++] = "-f";
+    args[n++] = "image2pipe";
+    args[n++] = "pipe:1";
+    args[n]   = NULL;
+
+    // Close-on-exec, so that decoders started from other threads do not
+    // hold the write end open
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return SM_ERR_SPAWN;
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return SM_ERR_SPAWN;
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_RDWR);
+        if (null != -1) dup2(null, STDIN_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        execvp(ffmpeg, (char *const *)args);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    FILE *in = fdopen(fds[0], "rb");
+    if (!in) {
+        close(fds[0]);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return SM_ERR_NOMEM;
+    }
+
+    gray_image_t img = { 0 };
+    size_t size = 0;
+    int frames = 0, rc;
+    while ((rc = read_pgm(in, &img, &size)) == 1) {
+        frames++;
+        rc = deliver(ctx, &img, frames, (double)(frames - 1) / ctx->fps, on_frame, opaque);
+        if (rc != SM_OK) break;
+    }
+    if (rc != 0) kill(pid, SIGTERM);  // stopped early, whatever the decoder was doing
+    fclose(in);
+    free(img.pixels);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    if (rc != 0) return rc;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) return SM_ERR_SPAWN;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || frames == 0) return SM_ERR_DECODE;
+    return SM_OK;
+}
+
+int sm_convert(sm_context_t *ctx, const char *input,
+               sm_frame_fn on_frame, void *opaque) {
+    if (!ctx || !input || !on_frame || ctx->width <= 0 || ctx->fps <= 0 ||
+        ctx->start < 0 || ctx->duration < 0) {
+        return SM_ERR_INVALID;
+    }
+    if (!strstr(input, "://") && access(input, R_OK) != 0) return SM_ERR_OPEN;
+    sm_reset(ctx);  // a new video: stabilization starts over
+    return convert(ctx, input, on_frame, opaque);
+}
+
+const char *sm_strerror(int code) {
+    switch (code) {
+    case SM_OK:          return "success";
+    case SM_ERR_INVALID: return "invalid argument";
+    case SM_ERR_NOMEM:   return "out of memory";
+    case SM_ERR_BUFFER:  return "buffer too small";
+    case SM_ERR_OPEN:    return "cannot open input";
+    case SM_ERR_FORMAT:  return "not a binary PGM image";
+    case SM_ERR_SPAWN:   return "cannot start the decoder";
+    case SM_ERR_DECODE:  return "decoding failed";
+    case SM_ERR_STOPPED: return "stopped by the frame callback";
+    default:             return "unknown error";
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef LIBSM_H
+#define LIBSM_H
+
+#include "ascii.h"
+#include <stddef.h>
+
+// Embeddable conversion and rendering: libsm.a (make lib).
+//
+// Everything sm does to turn video into ASCII frames, for use in-process by
+// other programs. All settings live in an explicit context instead of the
+// CLI's globals, rendered text goes into buffers the caller provides, and
+// every failure is returned as an SM_ERR_* code; nothing here prints, exits
+// or installs signal handlers. A context is used by one thread at a time;
+// separate contexts are independent.
+
+// Status codes: 0 or a negative SM_ERR_* value
+#define SM_OK             0
+#define SM_ERR_INVALID   -1   // bad argument or context setting
+#define SM_ERR_NOMEM     -2   // out of memory
+#define SM_ERR_BUFFER    -3   // caller's buffer too small (the size needed is reported)
+#define SM_ERR_OPEN      -4   // input file missing or unreadable
+#define SM_ERR_FORMAT    -5   // not a binary PGM image
+#define SM_ERR_SPAWN     -6   // decoder could not be started
+#define SM_ERR_DECODE    -7   // decoder failed or produced no frames
+#define SM_ERR_STOPPED   -8   // the frame callback asked to stop
+
+typedef struct {
+    int         width;      // frame width in characters (the video is scaled to it)
+    int         fps;        // frames sampled per second of video
+    double      start;      // seconds into the input to start at
+    double      duration;   // seconds to convert, 0 = until the end
+    dither_t    dither;     // glyph quantization
+    int         stabilize;  // glyph hysteresis margin in luma units, 0 = off
+    int         threads;    // threads per rendered frame, 0 = one per CPU
+    const char *ffmpeg;     // decoder program, NULL = "ffmpeg" on the PATH
+
+    // Private: managed by sm_init(), sm_reset() and sm_release()
+    ascii_history_t *history;
+    char            *frame;
+    size_t           frame_size;
+} sm_context_t;
+
+// Receives each converted frame during sm_convert(). `text` (`len` bytes,
+// one '\n' per row, not NUL-terminated) is owned by the context and valid
+// only for the duration of the call. `index` is 1-based and `pts` is the time
+// the frame is shown at, in seconds from the start. Return 0 to continue.
+typedef int (*sm_frame_fn)(const char *text, size_t len, int index,
+                           double pts, void *opaque);
+
+// Fill `ctx` with the CLI's defaults (900 wide, 10 fps, Bayer dither)
+void sm_init(sm_context_t *ctx);
+
+// Release what the context holds; it may be reused after sm_init()
+void sm_release(sm_context_t *ctx);
+
+// Forget the previous frame, so that stabilization starts over (between
+// unrelated videos rendered with sm_render())
+void sm_reset(sm_context_t *ctx);
+
+// Continue a video after `text` (`len` bytes), a frame of it rendered
+// earlier, e.g. by a conversion that was interrupted: with stabilization the
+// next frame is rendered as if `text` had just been. Returns SM_OK, or
+// SM_ERR_FORMAT if `text` is not a rendered frame.
+int sm_resume(sm_context_t *ctx, const char *text, size_t len);
+
+// Bytes of text for a width x height gray image
+size_t sm_frame_size(int width, int height);
+
+// Render `img` into `buf` of `size` bytes and set `*len` to the text length.
+// Consecutive calls are treated as consecutive frames of one video. Returns
+// SM_OK, or SM_ERR_BUFFER with `*len` set to the size needed.
+int sm_render(sm_context_t *ctx, const gray_image_t *img,
+              char *buf, size_t size, size_t *len);
+
+// As sm_render(), for a binary PGM image on disk
+int sm_render_pgm(sm_context_t *ctx, const char *path,
+                  char *buf, size_t size, size_t *len);
+
+// Decode the video at `input` (a path or URL ffmpeg can open) and hand every
+// frame, rendered, to `on_frame`. ffmpeg runs as a child process, which is
+// stopped if the callback stops early. Returns SM_OK once every frame was
+// delivered, or an SM_ERR_* code.
+int sm_convert(sm_context_t *ctx, const char *input,
+               sm_frame_fn on_frame, void *opaque);
+
+// Description of a status code
+const char *sm_strerror(int code);
+
+#endif // LIBSM_H
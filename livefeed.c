@@ -0,0 +1,198 @@
+#define _DEFAULT_SOURCE
+
+#include "livefeed.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { SLOT_FREE, SLOT_READING, SLOT_QUEUED, SLOT_SHOWN };
+
+struct slot {
+    gray_image_t img;
+    size_t       size;     // bytes allocated for img.pixels
+    double       arrived;
+    int          state;
+};
+
+struct live_feed {
+    FILE           *in;
+    struct slot    *slots;     // capacity + 2
+    int             nslots;
+    int            *queue;     // ring of queued slot numbers, oldest first
+    int             capacity;
+    int             head;
+    int             count;
+    int             shown;     // slot handed out by live_feed_next(), or -1
+    int             eof;
+    size_t          received;
+    size_t          dropped;
+    pthread_mutex_t lock;      // guards everything above but `in`
+    pthread_cond_t  ready;     // a frame was queued or the stream ended
+    pthread_t       tid;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Take the oldest queued slot off the queue (caller holds the lock)
+static int pop_oldest(live_feed_t *f) {
+    int s = f->queue[f->head];
+    f->head = (f->head + 1) % f->capacity;
+    f->count--;
+    return s;
+}
+
+// A slot to read the next frame into: a free one, or the oldest queued frame
+// when the queue is full (caller holds the lock)
+static int take_slot(live_feed_t *f) {
+    if (f->count == f->capacity) {
+        f->dropped++;
+        return pop_oldest(f);
+    }
+    for (int s = 0; s < f->nslots; s++) {
+        if (f->slots[s].state == SLOT_FREE) return s;
+    }
+    return -1;  // not reached: capacity + 2 slots cover every state
+}
+
+// Read one PGM image into `sl`; returns 0, or -1 at the end of the stream
+static int read_frame(FILE *in, struct slot *sl) {
+    int width, height, maxval;
+    if (fscanf(in, "P5 %d %d %d", &width, &height, &maxval) != 3 || fgetc(in) == EOF ||
+        width <= 0 || height <= 0 || maxval != 255) {
+        return -1;
+    }
+    size_t size = (size_t)width * (size_t)height;
+    if (size > sl->size) {
+        uint8_t *grown = realloc(sl->img.pixels, size);
+        if (!grown) return -1;
+        sl->img.pixels = grown;
+        sl->size       = size;
+    }
+    sl->img.width  = width;
+    sl->img.height = height;
+    sl->img.stride = width;
+    return fread(sl->img.pixels, 1, size, in) == size ? 0 : -1;
+}
+
+static void *reader_thread(void *arg) {
+    live_feed_t *f = arg;
+    for (;;) {
+        pthread_mutex_lock(&f->lock);
+        int s = take_slot(f);
+        f->slots[s].state = SLOT_READING;
+        pthread_mutex_unlock(&f->lock);
+
+        int rc = read_frame(f->in, &f->slots[s]);
+
+        pthread_mutex_lock(&f->lock);
+        if (rc != 0) {
+            f->slots[s].state = SLOT_FREE;
+            f->eof = 1;
+            pthread_cond_signal(&f->ready);
+            pthread_mutex_unlock(&f->lock);
+            return NULL;
+        }
+        f->slots[s].arrived = now();
+        f->slots[s].state   = SLOT_QUEUED;
+        f->queue[(f->head + f->count) % f->capacity] = s;
+        f->count++;
+        f->received++;
+        pthread_cond_signal(&f->ready);
+        pthread_mutex_unlock(&f->lock);
+    }
+}
+
+live_feed_t *live_feed_start(int fd, int capacity) {
+    if (capacity < 1) capacity = 1;
+    live_feed_t *f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->capacity = capacity;
+    f->nslots   = capacity + 2;
+    f->shown    = -1;
+    f->slots    = calloc((size_t)f->nslots, sizeof(*f->slots));
+    f->queue    = calloc((size_t)capacity, sizeof(*f->queue));
+    f->in       = fdopen(fd, "rb");
+    if (!f->slots || !f->queue || !f->in) {
+        if (f->in) fclose(f->in);
+        free(f->queue);
+        free(f->slots);
+        free(f);
+        return NULL;
+    }
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->ready, NULL);
+    if (pthread_create(&f->tid, NULL, reader_thread, f) != 0) {
+        pthread_cond_destroy(&f->ready);
+        pthread_mutex_destroy(&f->lock);
+        fclose(f->in);
+        free(f->queue);
+        free(f->slots);
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+int live_feed_next(live_feed_t *f, double max_age, gray_image_t *img) {
+    pthread_mutex_lock(&f->lock);
+    if (f->shown != -1) {
+        f->slots[f->shown].state = SLOT_FREE;
+        f->shown = -1;
+    }
+    while (f->count == 0 && !f->eof) pthread_cond_wait(&f->ready, &f->lock);
+    if (f->count == 0) {
+        pthread_mutex_unlock(&f->lock);
+        return 0;
+    }
+
+    // Catch up: anything that has waited too long is skipped, as long as
+    // something newer is there to show instead
+    double t = now();
+    while (f->count > 1 && t - f->slots[f->queue[f->head]].arrived > max_age) {
+        f->slots[pop_oldest(f)].state = SLOT_FREE;
+        f->dropped++;
+    }
+    int s = pop_oldest(f);
+    f->slots[s].state = SLOT_SHOWN;
+    f->shown = s;
+    *img = f->slots[s].img;
+    pthread_mutex_unlock(&f->lock);
+    return 1;
+}
+
+double live_feed_age(const live_feed_t *f) {
+    // The shown slot is not touched by the reader: no lock needed
+    return f->shown != -1 ? now() - f->slots[f->shown].arrived : 0;
+}
+
+size_t live_feed_received(live_feed_t *f) {
+    pthread_mutex_lock(&f->lock);
+    size_t n = f->received;
+    pthread_mutex_unlock(&f->lock);
+    return n;
+}
+
+size_t live_feed_dropped(live_feed_t *f) {
+    pthread_mutex_lock(&f->lock);
+    size_t n = f->dropped;
+    pthread_mutex_unlock(&f->lock);
+    return n;
+}
+
+void live_feed_stop(live_feed_t *f) {
+    if (!f) return;
+    pthread_join(f->tid, NULL);
+    fclose(f->in);
+    for (int s = 0; s < f->nslots; s++) free(f->slots[s].img.pixels);
+    pthread_cond_destroy(&f->ready);
+    pthread_mutex_destroy(&f->lock);
+    free(f->queue);
+    free(f->slots);
+    free(f);
+}
@@ -0,0 +1,40 @@
+#ifndef LIVEFEED_H
+#define LIVEFEED_H
+
+#include "ascii.h"
+#include <stddef.h>
+
+// Bounded-latency queue of frames arriving from a live decoder.
+//
+// A reader thread takes binary PGM images (as written by ffmpeg's image2pipe
+// muxer) off a pipe as fast as they come, so the decoder and its producer are
+// never held back by a slow terminal. At most `capacity` frames wait to be
+// shown: when the queue is full the oldest waiting frame is dropped, and the
+// consumer also skips frames that have waited longer than the latency cap.
+// Memory is therefore fixed at capacity + 2 frame buffers (one being read,
+// one being shown).
+
+typedef struct live_feed live_feed_t;
+
+// Start reading frames from `fd` (taken over and closed by live_feed_stop()).
+// Returns NULL if out of memory or the thread cannot be started.
+live_feed_t *live_feed_start(int fd, int capacity);
+
+// Wait for the next frame to show and point `img` at it; the image stays
+// valid until the next call. Frames older than `max_age` seconds are dropped,
+// except the newest one. Returns 1 with a frame, 0 once the stream has ended
+// and the queue is empty.
+int live_feed_next(live_feed_t *f, double max_age, gray_image_t *img);
+
+// Seconds since the frame last returned by live_feed_next() arrived
+double live_feed_age(const live_feed_t *f);
+
+// Frames received and frames dropped so far
+size_t live_feed_received(live_feed_t *f);
+size_t live_feed_dropped(live_feed_t *f);
+
+// Wait for the reader to reach the end of the stream (close the write end,
+// or stop the decoder, first), then release everything
+void live_feed_stop(live_feed_t *f);
+
+#endif // LIVEFEED_H
@@ -27,15 +27,35 @@
 #include <signal.h>       /* Signal handling */
 #include "err.h"          /* Custom error handling */
 #include "spinner.h"      /* Custom loading spinner */
+#include "ascii.h"        /* In-process frame to ASCII converter */
+#include "stage.h"        /* Dependency-aware pipeline stage runner */
+#include "framecache.h"   /* Memory-bounded frame cache for playback */
+#include "adaptive.h"     /* Throughput-adaptive playback quality */
+#include "timedstream.h"  /* Pre-rendered terminal stream export and replay */
+#include "frameindex.h"   /* Content-addressed frame deduplication */
+#include "batchio.h"      /* Batched file I/O over io_uring */
+#include "library.h"      /* Disk budget for converted videos */
+#include "daemon.h"       /* Background conversion service */
+#include "fdcopy.h"       /* Kernel-side output of frame files */
+#include "term.h"         /* Tear-free full-screen presentation */
+#include "livefeed.h"     /* Bounded-latency queue for live input */
+#include "libsm.h"        /* Embeddable conversion and rendering */
+#include "vt.h"           /* In-memory terminal for checking playback output */
+#include <sys/resource.h> /* Peak memory usage reporting */
+#include <sys/prctl.h>    /* Tying extractor processes to their stage */
+#include <poll.h>         /* Waiting on pipe file descriptors */
+#include <sys/file.h>     /* Locking a video against concurrent conversions */
 #include <time.h>         /* Time and date functions */
 #include <fnmatch.h>      /* Filename matching */
 #include <ctype.h>        /* Character type functions */
+#include <glob.h>         /* Expanding wildcard input patterns */
 
 /* Directory structure for assets */
 #define ASSETS_DIR "assets"        /* Main assets directory */
 #define AUDIO_DIR "assets/audio"   /* Directory for extracted audio */
 #define ASCII_DIR "assets/ascii"   /* Directory for ASCII art frames */
 #define FRAMES_DIR "assets/frames" /* Directory for extracted video frames */
+#define DAEMON_SOCKET "assets/sm.sock" /* Socket of the conversion daemon */
 
 /* Default configuration values */
 #define DEFAULT_FPS "10"              /* Frames per second for playback */
@@ -45,8 +65,29 @@
 #define DEFAULT_VIDEO_PATH "rr.mp4"   /* Default video file path */
 #define DEFAULT_VIDEO_NAME "rr"       /* Default video name (without extension) */
 #define DEFAULT_DURATION "0"          /* Duration in seconds (0 means full video) */
+#define DEFAULT_DITHER "bayer"        /* Glyph quantization mode (none, bayer) */
+#define DEFAULT_STABILIZE "0"         /* Glyph hysteresis margin in luma units (0 = off) */
+#define DEFAULT_JOBS "0"              /* Concurrent batch jobs (0 = one per CPU) */
+#define DEFAULT_SEGMENTS "1"          /* Parallel frame extractors per video */
+#define DEFAULT_MEM_BUDGET "64M"      /* Cap on frames mapped during playback (0 = no cap) */
+#define DEFAULT_DISK_BUDGET "0"       /* Cap on disk used by converted videos (0 = no cap) */
+#define DEFAULT_MAX_LATENCY "500"     /* Cap on live input latency in milliseconds */
 
 #define BUFFER_SIZE 1024 /* Standard buffer size for I/O operations */
+#define FILTER_SIZE (BUFFER_SIZE + 4 * PATH_MAX) /* ffmpeg filter graph, with room for an escaped path */
+#define AUDIO_PATH_SIZE (2 * PATH_MAX + 16) /* Audio file path, in AUDIO_DIR or a working directory */
+
+/* Audio codecs stream-copied rather than re-encoded, and the extension of
+   their container; every player find_available_player() looks for takes all
+   of them. Audio in any other codec is encoded to MP3. */
+static const struct
+{
+    const char *codec; /* Codec name in ffmpeg's stream description */
+    const char *ext;   /* Extension of the extracted audio file */
+} AUDIO_FORMATS[] = {
+    {"mp3", ".mp3"}, {"aac", ".m4a"}, {"opus", ".opus"}, {"vorbis", ".ogg"}, {"flac", ".flac"},
+};
+#define AUDIO_FORMAT_COUNT (sizeof(AUDIO_FORMATS) / sizeof(AUDIO_FORMATS[0]))
 
 /* Global variables for configuration */
 char VIDEO_PATH[PATH_MAX] = DEFAULT_VIDEO_PATH; /* Path to the input video file */
@@ -56,6 +97,60 @@ char *HEIGHT = DEFAULT_HEIGHT;                  /* Height of ASCII output */
 char *START_TIME = DEFAULT_START_TIME;          /* Start time for video extraction */
 char *DURATION = DEFAULT_DURATION;              /* Duration to extract (0 = full video) */
 char VIDEO_NAME[PATH_MAX] = DEFAULT_VIDEO_NAME; /* Name of the video (without extension) */
+char *DITHER = DEFAULT_DITHER;                  /* Glyph quantization mode for conversion */
+char *STABILIZE = DEFAULT_STABILIZE;            /* Luma margin before a cell changes glyph */
+int SINGLE_PASS = 0;                            /* Decode once for both audio and frames */
+int VFR = 0;                                    /* Keep the source's frame timing instead of resampling to FPS */
+char *JOBS = DEFAULT_JOBS;                      /* Concurrency limit for batch conversion */
+char *SEGMENTS = DEFAULT_SEGMENTS;              /* Time segments extracted in parallel */
+char *MEM_BUDGET = DEFAULT_MEM_BUDGET;          /* Memory budget for playback frame buffers */
+char *DISK_BUDGET = DEFAULT_DISK_BUDGET;        /* Disk budget for the converted-video library */
+char *MAX_LATENCY = DEFAULT_MAX_LATENCY;        /* Latency cap for live input, in milliseconds */
+int ADAPTIVE = 0;                               /* Adapt output to the measured stdout throughput */
+char *EXPORT_PATH = NULL;                       /* Write a timed terminal stream instead of playing */
+int HEADLESS = 0;                               /* Draw frames back to back without waiting (benchmark) */
+int BENCH_FRAMES = 0;                           /* Frames of the synthetic benchmark to run (0 = none) */
+int VT_SINK = 0;                                /* Play into an emulated terminal and check each frame */
+int RENDER_THREADS = 0;                         /* Threads per frame for ASCII rendering (0 = one per CPU) */
+int RUN_DAEMON = 0;                             /* Serve conversion jobs instead of converting */
+int ASYNC = 0;                                  /* Hand conversions to the daemon and return */
+int PRIORITY = 0;                               /* Priority of jobs handed to the daemon */
+
+/* Private directory of the running conversion's intermediate frames (see open_work_dir()) */
+char WORK_DIR[PATH_MAX] = FRAMES_DIR;
+int RESUME_FRAMES = 0; /* Frames of an interrupted conversion that the running one keeps (see resume_point()) */
+
+/* Input files queued with -i (more than one, or a directory, means batch mode) */
+char **INPUTS = NULL;
+int INPUT_COUNT = 0;
+
+/* Videos named with -p, played back to back (see draw_frames()) */
+char **PLAYLIST = NULL;
+int PLAYLIST_COUNT = 0;
+int LOOP = 0; /* Start the playlist (or video) over when it ends */
+
+/* Long-only option identifiers (outside the range of short option characters) */
+enum
+{
+    OPT_DITHER = 256, /* --dither MODE */
+    OPT_SINGLE_PASS,  /* --single-pass */
+    OPT_MEM_BUDGET,   /* --mem-budget SIZE */
+    OPT_ADAPTIVE,     /* --adaptive */
+    OPT_EXPORT,       /* --export FILE */
+    OPT_REPLAY,       /* --replay FILE */
+    OPT_BENCH,        /* --bench FRAMES */
+    OPT_DISK_BUDGET,  /* --disk-budget SIZE */
+    OPT_SEGMENTS,     /* --segments N */
+    OPT_DAEMON,       /* --daemon */
+    OPT_ASYNC,        /* --async */
+    OPT_PRIORITY,     /* --priority N */
+    OPT_STATUS,       /* --status */
+    OPT_VFR,          /* --vfr */
+    OPT_STABILIZE,    /* --stabilize MARGIN */
+    OPT_MAX_LATENCY,  /* --max-latency MS */
+    OPT_LOOP,         /* --loop */
+    OPT_SINK          /* --sink MODE */
+};
 
 /* Flag for signal handling */
 static volatile sig_atomic_t sigint_received = 0;
@@ -73,24 +168,61 @@ static void handle_sigint(int sig)
 }
 
 /* Forward declarations of functions */
-void extract_images_grayscale();                               /* Extract frames from video as grayscale images */
+int extract_images_grayscale(int upstream_fd);                 /* Extract frames from video as grayscale images */
+int extract_images_segmented(int segments);                    /* Extract frames with parallel ffmpeg processes */
 char *get_usage_msg(const char *program_name);                 /* Generate usage message */
 void create_dir(const char *dir_name);                         /* Create directory if it doesn't exist */
 void empty_directory(const char *dir_name);                    /* Remove all files in directory */
+void remove_matching(const char *dir_path, const char *pattern); /* Remove files matching a pattern */
+void remove_video_frames(const char *name);                    /* Remove a video's frames and frame index */
+void open_work_dir();                                          /* Claim the current video and make its working directory */
+void close_work_dir();                                         /* Remove the working directory and release the video */
+void enforce_disk_budget(const char *const *keep, size_t nkeep, int incoming); /* Evict least recently played videos */
+void mark_played(const char *name);                            /* Record that a video was just played */
+void run_bench(int frames);                                    /* Synthetic conversion and playback benchmark */
+void frames_progress(char *buf, size_t len);                   /* Progress note for frame extraction */
+void ascii_progress(char *buf, size_t len);                    /* Progress note for ASCII conversion */
 void setup();                                                  /* Setup directories and extract video/audio */
 void reset();                                                  /* Reset directories and settings */
 void play();                                                   /* Play the ASCII video with audio */
 void draw_frames();                                            /* Display ASCII frames in sequence */
-void draw_ascii_frame(const char *frame_path);                 /* Display a single ASCII frame */
-void batch_convert_to_ascii();                                 /* Convert grayscale images to ASCII art */
-void extract_audio();                                          /* Extract audio from video */
-void play_audio();                                             /* Play extracted audio */
+int is_live_input(const char *path);                           /* Check if an input is a stream rather than a file */
+void play_live();                                              /* Convert and show a live input as it arrives */
+void draw_ascii_frame(const char *frame, size_t len);          /* Display a single ASCII frame */
+int ascii_frame_path(int index, char *buf, size_t len, void *opaque); /* Path of a numbered ASCII frame */
+double now_seconds();                                          /* Monotonic clock in seconds */
+void export_frames(const char *path);                          /* Write a pre-rendered timed stream */
+void frame_path(char *buf, size_t len, const char *dir, int index, const char *ext); /* Path of a numbered frame */
+void video_frame_path(char *buf, size_t len, const char *dir, const char *name, int index, const char *ext); /* Same, for any video */
+void index_path(char *buf, size_t len, const char *name);      /* Path of a video's frame index */
+void journal_path(char *buf, size_t len, const char *name);    /* Path of the frame index a conversion is writing */
+int resume_point();                                            /* Frames an interrupted conversion left that can be kept */
+void record_job();                                             /* Record the settings a new conversion runs with */
+void commit_conversion();                                      /* Publish a finished conversion's frame index and audio */
+void pts_log_path(char *buf, size_t len, const char *name);    /* Path of a video's frame timestamp log */
+int load_frame_index(const char *name, frame_index_t *idx);    /* Load a video's frame index */
+void dedup_summary(const char *name, char *buf, size_t len);   /* Describe a video's deduplication */
+int batch_convert_to_ascii(int upstream_fd);                   /* Convert grayscale images to ASCII art */
+int extract_audio(int upstream_fd);                            /* Extract audio from video */
+int extract_audio_and_images(int upstream_fd);                 /* Extract audio and frames in one ffmpeg pass */
+void play_audio(const char *audio_file);                       /* Play an extracted audio track */
+int audio_path(char *buf, size_t len, const char *name);       /* Find a video's extracted audio file */
 int directory_exists(const char *path);                        /* Check if directory exists */
 int is_directory_empty(const char *dir_path);                  /* Check if directory is empty */
 int dir_contains(const char *dir_path, const char *file_name); /* Check if directory contains file matching pattern */
-int video_extracted();                                         /* Check if video has been extracted */
+int video_extracted(const char *name);                          /* Check if a video has been extracted */
 int is_valid_integer(const char *str);                         /* Validate string is a positive integer */
 int is_valid_timestamp(const char *str);                       /* Validate string is in HH:MM:SS format */
+void add_input(const char *arg);                               /* Queue an input file, directory or pattern */
+void video_name_from_path(const char *path, char *name, size_t len); /* Derive a video name from a path */
+void convert_batch();                                          /* Convert all queued inputs through a job queue */
+void run_daemon();                                             /* Serve conversion jobs on the daemon socket */
+int daemon_job(const daemon_job_t *job, void *opaque);         /* Run one conversion job for the daemon */
+void submit_inputs();                                          /* Queue the inputs with the daemon */
+void show_status();                                            /* Print the daemon's job list */
+int video_converting(const char *name);                        /* Check if the daemon is still converting a video */
+int render_threads();                                          /* Threads to use when rendering one frame */
+void render_context(sm_context_t *ctx);                        /* Rendering settings as a libsm context */
 
 /**
  * Reset all configuration values to defaults
@@ -102,6 +234,19 @@ void set_defaults()
     HEIGHT = DEFAULT_HEIGHT;
     START_TIME = DEFAULT_START_TIME;
     DURATION = DEFAULT_DURATION;
+    DITHER = DEFAULT_DITHER;
+    STABILIZE = DEFAULT_STABILIZE;
+    SINGLE_PASS = 0;
+    VFR = 0;
+    JOBS = DEFAULT_JOBS;
+    SEGMENTS = DEFAULT_SEGMENTS;
+    MEM_BUDGET = DEFAULT_MEM_BUDGET;
+    DISK_BUDGET = DEFAULT_DISK_BUDGET;
+    MAX_LATENCY = DEFAULT_MAX_LATENCY;
+    ADAPTIVE = 0;
+    LOOP = 0;
+    VT_SINK = 0;
+    EXPORT_PATH = NULL;
     VIDEO_PATH[0] = '\0'; /* Clear video path */
     VIDEO_NAME[0] = '\0'; /* Clear video name */
 }
@@ -125,29 +270,66 @@ int main(int argc, char *argv[])
     sigemptyset(&sa.sa_mask);
     sigaction(SIGINT, &sa, NULL);
 
+    /* A disk budget can also be configured once in the environment */
+    char *env_budget = getenv("SM_DISK_BUDGET");
+    size_t env_bytes;
+    if (env_budget != NULL && parse_size(env_budget, &env_bytes) == 0)
+    {
+        DISK_BUDGET = env_budget;
+    }
+
     int c, optidx, opts_given = 0;
 
     /* Define long options for command line argument parsing */
     static struct option longopts[] = {
-        {"input", required_argument, 0, 'i'},    /* Input video file */
+        {"input", required_argument, 0, 'i'},    /* Input video file (repeatable) */
+        {"jobs", required_argument, 0, 'j'},     /* Concurrent conversions in batch mode */
+        {"segments", required_argument, 0, OPT_SEGMENTS}, /* Parallel frame extractors */
         {"fps", required_argument, 0, 'f'},      /* Frames per second */
         {"width", required_argument, 0, 'w'},    /* Width in characters */
         {"height", required_argument, 0, 't'},   /* Height in characters */
         {"start", required_argument, 0, 's'},    /* Start time */
         {"duration", required_argument, 0, 'd'}, /* Duration to extract */
-        {"play", required_argument, 0, 'p'},     /* Play a previously extracted video */
+        {"play", required_argument, 0, 'p'},     /* Play a previously extracted video (repeatable) */
+        {"loop", no_argument, 0, OPT_LOOP},      /* Play the videos over and over */
         {"reset", no_argument, 0, 'r'},          /* Reset settings and clear extracted files */
+        {"dither", required_argument, 0, OPT_DITHER}, /* Glyph quantization mode */
+        {"stabilize", required_argument, 0, OPT_STABILIZE}, /* Temporal glyph hysteresis */
+        {"single-pass", no_argument, 0, OPT_SINGLE_PASS}, /* One ffmpeg pass for audio and frames */
+        {"vfr", no_argument, 0, OPT_VFR},                 /* Keep the source's frame timing */
+        {"mem-budget", required_argument, 0, OPT_MEM_BUDGET}, /* Playback memory cap */
+        {"disk-budget", required_argument, 0, OPT_DISK_BUDGET}, /* Library disk cap */
+        {"max-latency", required_argument, 0, OPT_MAX_LATENCY}, /* Live input latency cap */
+        {"adaptive", no_argument, 0, OPT_ADAPTIVE},           /* Adapt to output throughput */
+        {"export", required_argument, 0, OPT_EXPORT},         /* Export a timed terminal stream */
+        {"sink", required_argument, 0, OPT_SINK},             /* Where playback output goes */
+        {"replay", required_argument, 0, OPT_REPLAY},         /* Replay an exported stream */
+        {"bench", required_argument, 0, OPT_BENCH},           /* Synthetic conversion + playback benchmark */
+        {"daemon", no_argument, 0, OPT_DAEMON},               /* Background conversion service */
+        {"async", no_argument, 0, OPT_ASYNC},                 /* Queue with the daemon and return */
+        {"priority", required_argument, 0, OPT_PRIORITY},     /* Priority of queued jobs */
+        {"status", no_argument, 0, OPT_STATUS},               /* Show the daemon's jobs */
         {"help", no_argument, 0, 'h'},           /* Display help */
         {0, 0, 0, 0}                             /* End of options */
     };
 
     /* Parse command line options */
-    while ((c = getopt_long(argc, argv, "i:f:w:t:s:d:p:rh", longopts, &optidx)) != -1)
+    while ((c = getopt_long(argc, argv, "i:j:f:w:t:s:d:p:rh", longopts, &optidx)) != -1)
     {
         switch (c)
         {
-        case 'i': /* Input video file */
+        case 'i': /* Input video file, directory or pattern */
             strncpy(VIDEO_PATH, optarg, sizeof(VIDEO_PATH) - 1);
+            add_input(optarg);
+            opts_given++;
+            break;
+
+        case 'j': /* Concurrent conversions in batch mode */
+            if (!is_valid_integer(optarg) || atoi(optarg) <= 0)
+            {
+                user_fatal("Invalid jobs value. Must be a positive integer.");
+            }
+            JOBS = optarg;
             opts_given++;
             break;
         case 'f': /* Frames per second */
@@ -210,20 +392,154 @@ int main(int argc, char *argv[])
             opts_given++;
             break;
 
+        case OPT_DITHER: /* Glyph quantization mode */
+        {
+            dither_t mode;
+            if (ascii_parse_dither(optarg, &mode) != 0)
+            {
+                user_fatal("Invalid dither mode. Must be 'none' or 'bayer'.");
+            }
+            DITHER = optarg;
+            opts_given++;
+            break;
+        }
+
+        case OPT_STABILIZE: /* Temporal hysteresis margin for glyph changes */
+            if (!is_valid_integer(optarg) || atoi(optarg) > 255)
+            {
+                user_fatal("Invalid stabilize margin. Must be an integer from 0 to 255.");
+            }
+            STABILIZE = optarg;
+            opts_given++;
+            break;
+
+        case OPT_SEGMENTS: /* Extract frames in parallel time segments */
+            if (!is_valid_integer(optarg) || atoi(optarg) <= 0)
+            {
+                user_fatal("Invalid segments value. Must be a positive integer.");
+            }
+            SEGMENTS = optarg;
+            break; /* Only changes how frames are extracted, not what */
+
+        case OPT_SINGLE_PASS: /* Decode the input once for audio and frames */
+            SINGLE_PASS = 1;
+            opts_given++;
+            break;
+
+        case OPT_VFR: /* Keep every source frame at its own timestamp */
+            VFR = 1;
+            opts_given++;
+            break;
+
+        case OPT_MEM_BUDGET: /* Cap on frame memory during playback */
+        {
+            size_t bytes;
+            if (parse_size(optarg, &bytes) != 0)
+            {
+                user_fatal("Invalid memory budget. Use a size such as 512K, 64M or 1G.");
+            }
+            MEM_BUDGET = optarg;
+            break; /* Playback-only setting, does not trigger a conversion */
+        }
+
+        case OPT_DISK_BUDGET: /* Cap on disk used by converted videos */
+        {
+            size_t bytes;
+            if (parse_size(optarg, &bytes) != 0)
+            {
+                user_fatal("Invalid disk budget. Use a size such as 500M or 2G.");
+            }
+            DISK_BUDGET = optarg;
+            break; /* Applies to conversions, does not trigger one by itself */
+        }
+
+        case OPT_MAX_LATENCY: /* Cap on how long a live frame may wait to be shown */
+            if (!is_valid_integer(optarg) || atoi(optarg) <= 0)
+            {
+                user_fatal("Invalid maximum latency. Must be a positive number of milliseconds.");
+            }
+            MAX_LATENCY = optarg;
+            break; /* Playback-only setting, does not trigger a conversion */
+
+        case OPT_LOOP: /* Start over at the end, until interrupted */
+            LOOP = 1;
+            break; /* Playback-only setting, does not trigger a conversion */
+
+        case OPT_ADAPTIVE: /* Keep real time on slow terminals and links */
+            ADAPTIVE = 1;
+            break; /* Playback-only setting, does not trigger a conversion */
+
+        case OPT_EXPORT: /* Export instead of playing */
+            EXPORT_PATH = optarg;
+            break; /* Replaces playback, does not trigger a conversion by itself */
+
+        case OPT_SINK: /* Where playback output goes */
+            if (strcmp(optarg, "tty") != 0 && strcmp(optarg, "vt") != 0)
+            {
+                user_fatal("Invalid sink. Use tty or vt.");
+            }
+            VT_SINK = strcmp(optarg, "vt") == 0;
+            break; /* Playback-only setting, does not trigger a conversion */
+
+        case OPT_BENCH: /* Benchmark conversion and headless playback, then exit */
+            if (!is_valid_integer(optarg) || atoi(optarg) <= 0)
+            {
+                user_fatal("Invalid bench frame count. Must be a positive integer.");
+            }
+            BENCH_FRAMES = atoi(optarg);
+            break; /* Started once all options are known */
+
+        case OPT_REPLAY: /* Replay an exported stream and exit */
+            fflush(stdout);
+            term_begin(STDOUT_FILENO);
+            if (tstream_replay(optarg, STDOUT_FILENO, &sigint_received) != 0)
+            {
+                term_end();
+                user_fatal("Cannot replay %s: not a readable recording", optarg);
+            }
+            term_end();
+            exit(EXIT_SUCCESS);
+            break;
+
         case 'r': /* Reset settings and clear extracted files */
             user_warning("This will delete all extracted files and reset settings.");
             reset();
             exit(EXIT_SUCCESS);
             break;
 
-        case 'p': /* Play a previously extracted video */
-            /* Copy the video name and play it */
-            strncpy(VIDEO_NAME, optarg, sizeof(VIDEO_NAME));
-            VIDEO_NAME[sizeof(VIDEO_NAME) - 1] = '\0'; /* Ensure null termination */
-            play();
+        case OPT_DAEMON: /* Serve conversion jobs until interrupted */
+            RUN_DAEMON = 1;
+            break; /* Started once all options are known */
+
+        case OPT_ASYNC: /* Queue the conversion with the daemon */
+            ASYNC = 1;
+            break;
+
+        case OPT_PRIORITY: /* Priority of queued jobs (higher runs first) */
+            if (!is_valid_integer(optarg))
+            {
+                user_fatal("Invalid priority. Must be a non-negative integer.");
+            }
+            PRIORITY = atoi(optarg);
+            break;
+
+        case OPT_STATUS: /* Show the daemon's jobs and exit */
+            show_status();
             exit(EXIT_SUCCESS);
             break;
 
+        case 'p': /* Play a previously extracted video (repeat for a playlist) */
+        {
+            char **grown = realloc(PLAYLIST, (PLAYLIST_COUNT + 1) * sizeof(*PLAYLIST));
+            if (grown == NULL)
+            {
+                fatal_error("Memory allocation failed for playlist");
+            }
+            PLAYLIST = grown;
+            PLAYLIST[PLAYLIST_COUNT++] = optarg;
+            break; /* Played once all options are known */
+        }
+
         case 'h': /* Display help message */
             user_error("%s", get_usage_msg(argv[0]));
             exit(EXIT_SUCCESS);
@@ -235,26 +551,88 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* Benchmark with every option given, wherever --bench came among them */
+    if (BENCH_FRAMES > 0)
+    {
+        run_bench(BENCH_FRAMES);
+        exit(EXIT_SUCCESS);
+    }
+
+    /* Play (or export) the videos named with -p */
+    if (PLAYLIST_COUNT > 0)
+    {
+        /* The first one is the current video */
+        strncpy(VIDEO_NAME, PLAYLIST[0], sizeof(VIDEO_NAME));
+        VIDEO_NAME[sizeof(VIDEO_NAME) - 1] = '\0'; /* Ensure null termination */
+        if (EXPORT_PATH)
+        {
+            if (PLAYLIST_COUNT > 1)
+            {
+                user_fatal("--export takes a single video");
+            }
+            if (video_converting(VIDEO_NAME))
+            {
+                user_fatal("%s is still being converted by the daemon (see --status)", VIDEO_NAME);
+            }
+            export_frames(EXPORT_PATH);
+        }
+        else
+        {
+            play();
+        }
+        exit(EXIT_SUCCESS);
+    }
+
+    /* Background conversion: serve jobs (the settings come with each job) */
+    if (RUN_DAEMON)
+    {
+        run_daemon();
+        exit(EXIT_SUCCESS);
+    }
+
+    /* A directory or pattern that matched nothing */
+    if (VIDEO_PATH[0] != '\0' && opts_given != 0 && INPUT_COUNT == 0)
+    {
+        user_fatal("No input files found in %s", VIDEO_PATH);
+    }
+
+    /* Live input (stdin or a FIFO): nothing to convert ahead, show frames as they arrive */
+    if (INPUT_COUNT == 1 && is_live_input(INPUTS[0]))
+    {
+        if (ASYNC || EXPORT_PATH || VT_SINK)
+        {
+            user_fatal("Live input can only be played, not queued, exported or sent to a sink");
+        }
+        play_live();
+        exit(EXIT_SUCCESS);
+    }
+
+    /* Background conversion: hand the inputs to the daemon */
+    if (ASYNC)
+    {
+        submit_inputs();
+        exit(EXIT_SUCCESS);
+    }
+
+    /* Several inputs (or a directory/pattern expanding to several): convert them all, no playback */
+    if (INPUT_COUNT > 1 || (INPUT_COUNT == 1 && strcmp(INPUTS[0], VIDEO_PATH) != 0))
+    {
+        convert_batch();
+        exit(EXIT_SUCCESS);
+    }
+
     /* If any option was given, extract the video name from path and process the video */
     if (opts_given != 0)
     {
         /* Extract the base filename without path or extension */
-        char *base = strrchr(VIDEO_PATH, '/');
-        base = base ? base + 1 : VIDEO_PATH;
-        strncpy(VIDEO_NAME, base, sizeof(VIDEO_NAME) - 1);
-        VIDEO_NAME[sizeof(VIDEO_NAME) - 1] = '\0'; /* Ensure null termination */
-
-        /* Remove extension from filename */
-        char *dot = strrchr(VIDEO_NAME, '.');
-        if (dot)
-            *dot = '\0';
+        video_name_from_path(VIDEO_PATH, VIDEO_NAME, sizeof(VIDEO_NAME));
 
         /* Process the video */
         setup();
     }
 
-    /* Play the video (either the default or the one that was just processed) */
-    play();
+    /* Play (or export) the video (either the default or the one that was just processed) */
+    EXPORT_PATH ? export_frames(EXPORT_PATH) : play();
     return EXIT_SUCCESS;
 }
 /**
@@ -315,6 +693,11 @@ void reset()
  * This function prepares the directory structure and extracts the necessary
  * assets from the video file: audio track, video frames, and converts frames
  * to ASCII art. This is the main preparation step before playback.
+ *
+ * The three steps run as a small pipeline (see stage.h): audio extraction is
+ * independent of the video path and overlaps it completely, and conversion
+ * consumes frames as ffmpeg writes them. If any stage fails, the others are
+ * stopped before the error is reported.
  */
 void setup()
 {
@@ -330,724 +713,3988 @@ void setup()
     create_dir(AUDIO_DIR);
     create_dir(FRAMES_DIR);
 
+    // Pick up where an interrupted conversion with the same settings stopped,
+    // or drop frames from an earlier conversion of the same video, since the
+    // streaming converter treats existing numbered frames as finished (once
+    // no other conversion of it is running)
+    open_work_dir();
+    RESUME_FRAMES = resume_point();
+    if (RESUME_FRAMES > 0)
+    {
+        char pattern[PATH_MAX + sizeof("_gray_*.tmp")];
+        snprintf(pattern, sizeof(pattern), "%s_gray_*.tmp", VIDEO_NAME);
+        remove_matching(ASCII_DIR, pattern);
+        user_info("%s: resuming an interrupted conversion after frame %d", VIDEO_NAME, RESUME_FRAMES);
+    }
+    else
+    {
+        remove_video_frames(VIDEO_NAME);
+        record_job();
+    }
+
+    // Make room for the new video before writing any of it
+    const char *keep[] = {VIDEO_NAME};
+    enforce_disk_budget(keep, 1, 1);
+
+    // Stage table: indices double as the dependency references
+    enum
+    {
+        STAGE_AUDIO,
+        STAGE_FRAMES,
+        STAGE_ASCII,
+        STAGE_COUNT
+    };
+    const stage_t stages[STAGE_COUNT] = {
+        [STAGE_AUDIO] = {"audio", extract_audio, STAGE_NONE, STAGE_NONE, NULL},
+        [STAGE_FRAMES] = {"frames", extract_images_grayscale, STAGE_NONE, STAGE_NONE, frames_progress},
+        [STAGE_ASCII] = {"ascii", batch_convert_to_ascii, STAGE_NONE, STAGE_FRAMES, ascii_progress},
+    };
+
+    // Single-pass mode: one ffmpeg writes audio and frames, conversion streams from it
+    enum
+    {
+        SP_STAGE_EXTRACT,
+        SP_STAGE_ASCII,
+        SP_STAGE_COUNT
+    };
+    const stage_t single_pass_stages[SP_STAGE_COUNT] = {
+        [SP_STAGE_EXTRACT] = {"audio+frames", extract_audio_and_images, STAGE_NONE, STAGE_NONE, frames_progress},
+        [SP_STAGE_ASCII] = {"ascii", batch_convert_to_ascii, STAGE_NONE, SP_STAGE_EXTRACT, ascii_progress},
+    };
+
     // Extract components from the video file
-    extract_audio();            // Extract audio track
-    extract_images_grayscale(); // Extract video frames as grayscale images
-    batch_convert_to_ascii();   // Convert frames to ASCII art
+    int failed;
+    const char *what; // Description of the failed extraction, if any
+    if (SINGLE_PASS)
+    {
+        failed = stage_run_all(single_pass_stages, SP_STAGE_COUNT, "Converting");
+        what = failed == SP_STAGE_EXTRACT ? "audio and frames" : NULL;
+    }
+    else
+    {
+        failed = stage_run_all(stages, STAGE_COUNT, "Converting");
+        what = failed == STAGE_AUDIO ? "audio" : failed == STAGE_FRAMES ? "frames" : NULL;
+    }
+
+    // Handle errors if any stage failed
+    if (what != NULL)
+    {
+        // Check if the error is due to missing input file
+        if (access(VIDEO_PATH, F_OK) != 0)
+        {
+            user_fatal("Video file not found: %s", VIDEO_PATH);
+        }
+        fatal_error("Failed to extract %s", what);
+    }
+    else if (failed != STAGE_NONE)
+    {
+        fatal_error("Failed to convert one or more frames to ASCII");
+    }
+
+    // The ASCII frames and their index are complete: publish them, and the
+    // extracted images have served their purpose
+    commit_conversion();
+
+    // Report how much deduplication saved
+    char summary[BUFFER_SIZE];
+    dedup_summary(VIDEO_NAME, summary, sizeof(summary));
+    user_info("%s: %s", VIDEO_NAME, summary);
+
+    // Settle the library now that the new video's real size is known
+    enforce_disk_budget(keep, 1, 0);
 }
 
 /**
- * Find an available media player
- *
- * This function checks for the availability of common media players
- * (ffplay, mpv, mplayer, vlc, aplay) and returns the first one found.
+ * Describe how well a converted video deduplicated
  *
- * @return A string containing the name of the available player, or NULL if none are found
+ * @param name Video name
+ * @param buf Output buffer for the description
+ * @param len Size of the output buffer
  */
-char* find_available_player()
+void dedup_summary(const char *name, char *buf, size_t len)
 {
-    static const char* players[] = {
-        "ffplay", "mpv", "mplayer", "vlc", "aplay", NULL
-    };
-    
-    for (int i = 0; players[i] != NULL; i++) {
-        char path[PATH_MAX];
-        snprintf(path, sizeof(path), "/usr/bin/%s", players[i]);
-        if (access(path, X_OK) == 0) {
-            return (char*)players[i];
-        }
+    char path[PATH_MAX];
+    frame_index_t idx;
+    index_path(path, sizeof(path), name);
+    if (frame_index_load(path, &idx) != 0)
+    {
+        snprintf(buf, len, "no frame index");
+        return;
     }
-    
-    return NULL;
+    snprintf(buf, len, "%d frames, %d stored (dedup ratio %.2f:1), %d distinct draws",
+             idx.count, idx.unique, (double)idx.count / idx.unique, idx.runs);
+    frame_index_free(&idx);
 }
 
 /**
- * Play the audio track of the current video
+ * Number of threads to use when rendering a single frame
  *
- * This function uses an available media player to play the extracted audio file
- * corresponding to the current video. All output is redirected to /dev/null
- * to avoid cluttering the terminal.
+ * One per online CPU unless batch mode has divided the CPUs between jobs.
+ *
+ * @return Thread count, at least 1
  */
-void play_audio()
+int render_threads()
 {
-    // Redirect output
-    int fd = open("/dev/null", O_RDWR);
-    dup2(fd, STDOUT_FILENO);
-    dup2(fd, STDERR_FILENO);
-    close(fd);
-
-    // Build audio file path
-    char audio_file[PATH_MAX + sizeof(AUDIO_DIR) + sizeof(".mp3") + sizeof(VIDEO_NAME)];
-    snprintf(audio_file, sizeof(audio_file), AUDIO_DIR "/%s.mp3", VIDEO_NAME);
-
-    // Find available player
-    char* player = find_available_player();
-    if (!player) {
-        user_fatal("No media player found. Please install ffplay, mpv, or mplayer.");
-    }
-    
-    // Execute appropriate player with right arguments
-    if (strcmp(player, "ffplay") == 0) {
-        execlp(player, player, "-nodisp", "-autoexit", "-loglevel", "quiet", audio_file, NULL);
-    } else if (strcmp(player, "mpv") == 0) {
-        execlp(player, player, "--no-video", "--really-quiet", audio_file, NULL);
-    } else if (strcmp(player, "mplayer") == 0) {
-        execlp(player, player, "-novideo", "-really-quiet", audio_file, NULL);
-    } else if (strcmp(player, "vlc") == 0) {
-        execlp(player, player, "--intf", "dummy", "--no-video", audio_file, NULL);
-    } else if (strcmp(player, "aplay") == 0) {
-        execlp(player, player, "-q", audio_file, NULL);
+    if (RENDER_THREADS > 0)
+    {
+        return RENDER_THREADS;
     }
-    
-    // If we get here, execution failed
-    fatal_error("Failed to play audio with %s", player);
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu < 1 ? 1 : (int)ncpu;
 }
 
 /**
- * Render a single ASCII art frame to the terminal
+ * Derive a video name (base file name without extension) from a path
  *
- * This function reads an ASCII art file and prints its contents to stdout,
- * displaying a single frame of the ASCII video.
- *
- * @param frame_path Path to the ASCII art file to display
+ * @param path Path to the video file
+ * @param name Output buffer for the name
+ * @param len Size of the output buffer
  */
-void draw_ascii_frame(const char *frame_path)
+void video_name_from_path(const char *path, char *name, size_t len)
 {
-    // Validate frame path is not NULL
-    if (frame_path == NULL)
-    {
-        fatal_error("Invalid frame path provided, path is NULL");
-    }
+    /* Extract the base filename without path or extension */
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(name, len, "%s", base);
 
-    // Open the ASCII frame file
-    FILE *file = fopen(frame_path, "r");
-    if (file == NULL)
-    {
-        fatal_error("Failed to open file: %s", frame_path);
-    }
+    /* Remove extension from filename */
+    char *dot = strrchr(name, '.');
+    if (dot)
+        *dot = '\0';
+}
 
-    // Read and display each line of the ASCII art
-    char line[BUFFER_SIZE];
-    while (fgets(line, sizeof(line), file) != NULL)
+/**
+ * Append a single path to the input queue
+ *
+ * @param path Path to a video file
+ */
+static void push_input(const char *path)
+{
+    char **grown = realloc(INPUTS, (INPUT_COUNT + 1) * sizeof(*INPUTS));
+    if (grown == NULL || (grown[INPUT_COUNT] = strdup(path)) == NULL)
     {
-        printf("%s", line); // Print each line to stdout
+        fatal_error("Memory allocation failed for input list");
     }
+    INPUTS = grown;
+    INPUT_COUNT++;
+}
 
-    // Clean up and add a trailing newline
-    fclose(file);
-    printf("\n");
+/* qsort comparator for directory listings */
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
 }
+
 /**
- * Draw ASCII frames in sequence to create video playback
+ * Queue the inputs named by one -i argument
  *
- * This function creates the visual playback by displaying ASCII art frames
- * in the terminal at the specified frame rate. It:
- * 1. Gets a sorted list of frame files for the current video
- * 2. Clears the screen before starting playback
- * 3. Displays each frame with appropriate timing between frames
- * 4. Handles timing according to the specified FPS
+ * A directory contributes every regular, non-hidden file inside it (in name
+ * order), a wildcard pattern that is not itself a file is expanded with glob(),
+ * and anything else is queued as-is so that a missing file is reported by its
+ * own job.
+ *
+ * @param arg Value given to -i
  */
-void draw_frames()
+void add_input(const char *arg)
 {
-    // Get sorted list of frame files (using system ls with -V for natural sorting)
-    char command[PATH_MAX + sizeof(ASCII_DIR) + sizeof("/*.txt") + sizeof(VIDEO_NAME)];
-    snprintf(command, sizeof(command), "ls %s/%s*.txt | sort -V", ASCII_DIR, VIDEO_NAME);
-
-    // Open a pipe to read the command output
-    FILE *pipe = popen(command, "r");
-    if (!pipe)
+    struct stat st;
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode))
     {
-        fatal_error("Failed to list files in directory: %s", ASCII_DIR);
-    }
+        DIR *dir = opendir(arg);
+        if (dir == NULL)
+        {
+            user_fatal("Cannot open input directory: %s", arg);
+        }
 
-    char file_path[PATH_MAX];
-    int frame_count = 0;
+        char **names = NULL;
+        size_t count = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", arg, entry->d_name);
+            if (entry->d_name[0] == '.' || stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            {
+                continue;
+            }
+            char **grown = realloc(names, (count + 1) * sizeof(*names));
+            if (grown == NULL || (grown[count] = strdup(path)) == NULL)
+            {
+                fatal_error("Memory allocation failed for input list");
+            }
+            names = grown;
+            count++;
+        }
+        closedir(dir);
 
-    // Clear screen before starting playback (ANSI escape sequence)
-    printf("\033[2J\033[1;1H");
+        qsort(names, count, sizeof(*names), compare_names);
+        for (size_t i = 0; i < count; i++)
+        {
+            push_input(names[i]);
+            free(names[i]);
+        }
+        free(names);
+        return;
+    }
 
-    // Process each frame in order
-    while (fgets(file_path, sizeof(file_path), pipe) != NULL)
+    glob_t matches;
+    if (access(arg, F_OK) != 0 && strpbrk(arg, "*?[") != NULL &&
+        glob(arg, 0, NULL, &matches) == 0)
     {
-        // Remove newline character from the file path
-        file_path[strcspn(file_path, "\n")] = 0;
-
-        // Clear screen before each frame (ANSI escape sequence)
-        // \033[2J clears the screen, \033[1;1H moves cursor to top-left
-        printf("\033[2J\033[1;1H");
-
-        // Draw the current frame to the terminal
-        draw_ascii_frame(file_path);
-        frame_count++;
-
-        // Calculate and implement delay between frames based on FPS
-        // Convert frames per second to microseconds per frame
-        int delay_us = 1000000 / atoi(FPS);
-
-        // Create timespec structure for nanosleep
-        struct timespec ts = {
-            .tv_sec = delay_us / 1000000,          // Seconds part
-            .tv_nsec = (delay_us % 1000000) * 1000 // Nanoseconds part
-        };
-
-        // Pause execution for the calculated time
-        nanosleep(&ts, NULL);
+        for (size_t i = 0; i < matches.gl_pathc; i++)
+        {
+            push_input(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+        return;
     }
 
-    // Close the pipe when playback is complete
-    pclose(pipe);
+    push_input(arg);
 }
 
+/* One entry of the batch job queue */
+struct batch_job
+{
+    const char *path;         /* Input file */
+    char name[PATH_MAX];      /* Video name derived from the path */
+    pid_t pid;                /* Worker process while running, -1 otherwise */
+    FILE *log;                /* Captured stderr of the worker */
+    int status;               /* 0 pending, 1 running, 2 succeeded, 3 failed */
+};
+
 /**
- * Check if the current video has been properly extracted and is ready for playback
+ * Convert every queued input through one job queue
  *
- * This function verifies that all necessary assets (audio and ASCII frames)
- * exist for the current video before attempting playback.
+ * Each input becomes a job that runs the normal conversion pipeline (see
+ * setup()) in its own worker process, so a failing input only fails its own
+ * job. At most JOBS workers run at once, and the CPUs are divided between them
+ * for frame rendering, so the whole machine stays busy until the queue drains.
+ * Each job's messages are captured and printed with its result at the end.
  *
- * @return true if all video assets are available, false otherwise
+ * JOBS limits inputs, not processes: every running job still has its own
+ * audio and frame extraction (several ffmpeg decoders with --segments), so
+ * up to JOBS times that many ffmpeg processes can run at once.
  */
-int video_extracted()
+void convert_batch()
 {
-    // Define file patterns to check for audio and ASCII frame files
-    char audio_file[PATH_MAX + sizeof(AUDIO_DIR) + sizeof(".mp3") + sizeof(VIDEO_NAME)] = {0};
-    char ascii_file[PATH_MAX + sizeof(ASCII_DIR) + sizeof(".txt") + sizeof(VIDEO_NAME)] = {0};
-
-    // Format the patterns using the current video name
-    snprintf(audio_file, sizeof(audio_file), "%s.mp3", VIDEO_NAME);
-    snprintf(ascii_file, sizeof(ascii_file), "%s_gray_*.txt", VIDEO_NAME);
-
-    // Check all necessary conditions:
-    // 1. Audio directory contains files
-    // 2. ASCII directory contains files
-    // 3. Audio directory contains the expected audio file
-    // 4. ASCII directory contains matching frame files
-    if (is_directory_empty(AUDIO_DIR) ||
-        is_directory_empty(ASCII_DIR) ||
-        !dir_contains(AUDIO_DIR, audio_file) ||
-        !dir_contains(ASCII_DIR, ascii_file))
+    int limit = atoi(JOBS);
+    if (limit <= 0)
     {
-        return false; // Missing required assets
+        limit = render_threads();
+    }
+    if (limit > INPUT_COUNT)
+    {
+        limit = INPUT_COUNT;
+    }
+
+    // Split the CPUs between concurrent jobs for frame rendering
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    RENDER_THREADS = ncpu > limit ? (int)(ncpu / limit) : 1;
+
+    create_dir(ASSETS_DIR);
+    create_dir(ASCII_DIR);
+    create_dir(AUDIO_DIR);
+    create_dir(FRAMES_DIR);
+
+    struct batch_job *jobs = calloc(INPUT_COUNT, sizeof(*jobs));
+    if (jobs == NULL)
+    {
+        fatal_error("Memory allocation failed for batch jobs");
+    }
+
+    // Jobs sharing a video name would overwrite each other's assets
+    for (int i = 0; i < INPUT_COUNT; i++)
+    {
+        jobs[i].path = INPUTS[i];
+        jobs[i].pid = -1;
+        video_name_from_path(INPUTS[i], jobs[i].name, sizeof(jobs[i].name));
+        for (int j = 0; j < i; j++)
+        {
+            if (strcmp(jobs[i].name, jobs[j].name) == 0)
+            {
+                jobs[i].status = 3; // Reported as a duplicate below
+            }
+        }
+    }
+
+    // The queue keeps the library within the disk budget around the whole
+    // batch, so that concurrent jobs never evict each other's videos
+    const char **keep = malloc(INPUT_COUNT * sizeof(*keep));
+    if (keep == NULL)
+    {
+        fatal_error("Memory allocation failed for batch jobs");
+    }
+    for (int i = 0; i < INPUT_COUNT; i++)
+    {
+        keep[i] = jobs[i].name;
+    }
+    enforce_disk_budget(keep, INPUT_COUNT, INPUT_COUNT);
+
+    spinner_t *sp = spinner_create("Converting batch");
+    spinner_start(sp);
+
+    int next = 0, running = 0, finished = 0, failed = 0;
+    while (finished < INPUT_COUNT)
+    {
+        // Fill free slots from the queue
+        while (running < limit && next < INPUT_COUNT)
+        {
+            struct batch_job *job = &jobs[next++];
+            if (job->status == 3)
+            {
+                finished++;
+                failed++;
+                continue;
+            }
+
+            job->log = tmpfile();
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                fatal_error("fork() failed: %s", strerror(errno));
+            }
+            if (pid == 0)
+            {
+                // Worker: quiet stdout, capture stderr, run the normal pipeline
+                int devnull = open("/dev/null", O_WRONLY);
+                dup2(devnull, STDOUT_FILENO);
+                close(devnull);
+                if (job->log)
+                {
+                    dup2(fileno(job->log), STDERR_FILENO);
+                }
+                snprintf(VIDEO_PATH, sizeof(VIDEO_PATH), "%s", job->path);
+                snprintf(VIDEO_NAME, sizeof(VIDEO_NAME), "%s", job->name);
+                DISK_BUDGET = DEFAULT_DISK_BUDGET; // Enforced by the queue instead
+                setup();
+                exit(EXIT_SUCCESS);
+            }
+            job->pid = pid;
+            job->status = 1;
+            running++;
+        }
+
+        // Wait for any worker to finish
+        int wstatus;
+        pid_t done = wait(&wstatus);
+        if (done < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int i = 0; i < INPUT_COUNT; i++)
+        {
+            if (jobs[i].status == 1 && jobs[i].pid == done)
+            {
+                int ok = WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+                jobs[i].status = ok ? 2 : 3;
+                failed += !ok;
+                running--;
+                finished++;
+            }
+        }
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Converting batch: %d/%d done, %d running, %d failed",
+                 finished, INPUT_COUNT, running, failed);
+        spinner_set_msg(sp, msg);
+    }
+
+    spinner_stop(sp, failed == 0);
+    spinner_destroy(sp);
+    enforce_disk_budget(keep, INPUT_COUNT, 0);
+    free(keep);
+
+    // Report one result per input
+    for (int i = 0; i < INPUT_COUNT; i++)
+    {
+        struct batch_job *job = &jobs[i];
+        if (job->status == 2)
+        {
+            char summary[BUFFER_SIZE];
+            dedup_summary(job->name, summary, sizeof(summary));
+            user_success("%s -> play with -p %s (%s)", job->path, job->name, summary);
+        }
+        else if (job->pid == -1)
+        {
+            user_error("%s: another input already uses the name '%s'", job->path, job->name);
+        }
+        else
+        {
+            user_error("%s: conversion failed", job->path);
+            if (job->log)
+            {
+                // Replay what the worker printed, indented under its input
+                char line[BUFFER_SIZE];
+                rewind(job->log);
+                while (fgets(line, sizeof(line), job->log) != NULL)
+                {
+                    fprintf(stderr, "    %s", line);
+                }
+            }
+        }
+        if (job->log)
+        {
+            fclose(job->log);
+        }
+    }
+    free(jobs);
+
+    if (failed > 0)
+    {
+        user_fatal("%d of %d inputs failed to convert", failed, INPUT_COUNT);
+    }
+}
+
+/**
+ * Run the background conversion service
+ *
+ * Serves DAEMON_SOCKET (see daemon.h) until interrupted. Every job is a
+ * normal conversion (see setup()) with the settings it was submitted with,
+ * run in its own process; at most JOBS run at once, highest priority first,
+ * and the CPUs are divided between them for frame rendering. Videos are
+ * playable with -p as soon as their job is done.
+ */
+void run_daemon()
+{
+    int limit = atoi(JOBS);
+    if (limit <= 0)
+    {
+        limit = render_threads();
+    }
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    RENDER_THREADS = ncpu > limit ? (int)(ncpu / limit) : 1;
+
+    create_dir(ASSETS_DIR);
+    create_dir(ASCII_DIR);
+    create_dir(AUDIO_DIR);
+    create_dir(FRAMES_DIR);
+
+    // Stop (and stop running jobs) on SIGTERM as well as Ctrl+C
+    struct sigaction sa = {0};
+    sa.sa_handler = handle_sigint;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+
+    user_info("Serving conversions on %s, %d at a time (Ctrl+C to stop)", DAEMON_SOCKET, limit);
+    if (daemon_serve(DAEMON_SOCKET, limit, daemon_job, NULL, &sigint_received) != 0)
+    {
+        if (errno == EADDRINUSE)
+        {
+            user_fatal("A daemon is already serving %s", DAEMON_SOCKET);
+        }
+        fatal_error("Cannot listen on %s: %s", DAEMON_SOCKET, strerror(errno));
+    }
+    user_success("Daemon stopped");
+}
+
+/**
+ * Run one conversion job for the daemon (in the job's own process)
+ *
+ * @param job Job to run; its spec holds the tab-separated key=value settings
+ *            written by submit_inputs()
+ * @param opaque Unused
+ * @return Exit status of the job
+ */
+int daemon_job(const daemon_job_t *job, void *opaque)
+{
+    (void)opaque;
+
+    // Progress lines have nobody to show them to; messages go to the daemon's log
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    // The settings point into this copy for the rest of the job
+    char *spec = strdup(job->spec);
+    if (spec == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    char *save;
+    for (char *field = strtok_r(spec, "\t", &save); field != NULL; field = strtok_r(NULL, "\t", &save))
+    {
+        char *value = strchr(field, '=');
+        if (value == NULL)
+        {
+            continue;
+        }
+        *value++ = '\0';
+        if (strcmp(field, "path") == 0)
+        {
+            strncpy(VIDEO_PATH, value, sizeof(VIDEO_PATH) - 1);
+        }
+        else if (strcmp(field, "fps") == 0)
+        {
+            FPS = value;
+        }
+        else if (strcmp(field, "width") == 0)
+        {
+            WIDTH = value;
+        }
+        else if (strcmp(field, "height") == 0)
+        {
+            HEIGHT = value;
+        }
+        else if (strcmp(field, "start") == 0)
+        {
+            START_TIME = value;
+        }
+        else if (strcmp(field, "duration") == 0)
+        {
+            DURATION = value;
+        }
+        else if (strcmp(field, "dither") == 0)
+        {
+            DITHER = value;
+        }
+        else if (strcmp(field, "stabilize") == 0)
+        {
+            STABILIZE = value;
+        }
+        else if (strcmp(field, "single_pass") == 0)
+        {
+            SINGLE_PASS = atoi(value);
+        }
+        else if (strcmp(field, "vfr") == 0)
+        {
+            VFR = atoi(value);
+        }
+        else if (strcmp(field, "segments") == 0)
+        {
+            SEGMENTS = value;
+        }
+    }
+    strncpy(VIDEO_NAME, job->name, sizeof(VIDEO_NAME) - 1);
+    VIDEO_NAME[sizeof(VIDEO_NAME) - 1] = '\0';
+
+    setup(); // Exits with a failure status on error
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Queue every input with the daemon, with the current settings
+ *
+ * Returns as soon as the daemon has accepted the jobs.
+ */
+void submit_inputs()
+{
+    if (INPUT_COUNT == 0)
+    {
+        user_fatal("Nothing to queue. Give the video to convert with -i.");
+    }
+
+    for (int i = 0; i < INPUT_COUNT; i++)
+    {
+        // The daemon may run in another directory than the input path is relative to
+        char path[PATH_MAX];
+        if (realpath(INPUTS[i], path) == NULL)
+        {
+            user_fatal("Video file not found: %s", INPUTS[i]);
+        }
+        if (strpbrk(path, "\t\n") != NULL)
+        {
+            user_fatal("Cannot queue %s: file names with tabs or newlines are not supported", path);
+        }
+        char name[PATH_MAX];
+        video_name_from_path(INPUTS[i], name, sizeof(name));
+
+        char request[DAEMON_SPEC_MAX + PATH_MAX];
+        int len = snprintf(request, sizeof(request),
+                 "SUBMIT\t%d\t%s\tpath=%s\tfps=%s\twidth=%s\theight=%s\tstart=%s\tduration=%s"
+                 "\tdither=%s\tstabilize=%s\tsingle_pass=%d\tvfr=%d\tsegments=%s",
+                 PRIORITY, name, path, FPS, WIDTH, HEIGHT, START_TIME, DURATION,
+                 DITHER, STABILIZE, SINGLE_PASS, VFR, SEGMENTS);
+        if (len < 0 || (size_t)len >= sizeof(request))
+        {
+            user_fatal("Cannot queue %s: the settings are too long", INPUTS[i]);
+        }
+
+        char reply[BUFFER_SIZE];
+        if (daemon_request(DAEMON_SOCKET, request, reply, sizeof(reply)) != 0)
+        {
+            user_fatal("No conversion daemon is running here. Start one with --daemon.");
+        }
+        if (strncmp(reply, "OK ", 3) != 0)
+        {
+            user_fatal("The daemon refused %s: %s", INPUTS[i], reply);
+        }
+        user_success("%s queued as job %d -> play with -p %s once done", INPUTS[i], atoi(reply + 3), name);
+    }
+}
+
+/**
+ * Split the next line of a STATUS reply into its fields
+ *
+ * @param cursor In/out position in the reply (modified in place)
+ * @param fields Output: job id, state, priority and video name
+ * @return 1 if a line was read, 0 at the end of the reply
+ */
+static int next_job_line(char **cursor, char *fields[4])
+{
+    while (**cursor != '\0')
+    {
+        char *line = *cursor;
+        char *end = strchr(line, '\n');
+        *cursor = end ? end + 1 : line + strlen(line);
+        if (end)
+        {
+            *end = '\0';
+        }
+
+        int n = 0;
+        for (char *f = line; n < 4 && f != NULL; n++)
+        {
+            fields[n] = f;
+            f = strchr(f, '\t');
+            if (f && n < 3)
+            {
+                *f++ = '\0';
+            }
+        }
+        if (n == 4)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Print the daemon's queued, running and finished jobs
+ */
+void show_status()
+{
+    static char reply[64 * BUFFER_SIZE];
+    if (daemon_request(DAEMON_SOCKET, "STATUS", reply, sizeof(reply)) != 0)
+    {
+        user_fatal("No conversion daemon is running here. Start one with --daemon.");
+    }
+    if (reply[0] == '\0')
+    {
+        user_info("No jobs yet");
+        return;
+    }
+
+    printf("%-6s %-8s %-8s %s\n", "JOB", "STATE", "PRIORITY", "VIDEO");
+    char *cursor = reply, *fields[4];
+    while (next_job_line(&cursor, fields))
+    {
+        printf("%-6s %-8s %-8s %s\n", fields[0], fields[1], fields[2], fields[3]);
+    }
+}
+
+/**
+ * Check if the daemon has a video queued or in conversion
+ *
+ * @param name Video name
+ * @return 1 if a job for it is queued or running, 0 otherwise (or without a daemon)
+ */
+int video_converting(const char *name)
+{
+    static char reply[64 * BUFFER_SIZE];
+    if (access(DAEMON_SOCKET, F_OK) != 0 ||
+        daemon_request(DAEMON_SOCKET, "STATUS", reply, sizeof(reply)) != 0)
+    {
+        return 0;
+    }
+
+    char *cursor = reply, *fields[4];
+    while (next_job_line(&cursor, fields))
+    {
+        if (strcmp(fields[3], name) == 0 &&
+            (strcmp(fields[1], "queued") == 0 || strcmp(fields[1], "running") == 0))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Find an available media player
+ *
+ * This function checks for the availability of common media players
+ * (ffplay, mpv, mplayer, vlc) and returns the first one found. Each of them
+ * plays every format in AUDIO_FORMATS (aplay, which only takes WAV, does not).
+ *
+ * @return A string containing the name of the available player, or NULL if none are found
+ */
+char* find_available_player()
+{
+    static const char* players[] = {
+        "ffplay", "mpv", "mplayer", "vlc", NULL
+    };
+    
+    for (int i = 0; players[i] != NULL; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "/usr/bin/%s", players[i]);
+        if (access(path, X_OK) == 0) {
+            return (char*)players[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Find the extracted audio file of a video
+ *
+ * Audio is stream-copied when its codec allows it, so the file may have any
+ * of the extensions in AUDIO_FORMATS.
+ *
+ * @param buf Output buffer for the path (the MP3 path if there is no audio file)
+ * @param len Size of the output buffer
+ * @param name Video name
+ * @return 0 if the audio file exists, -1 otherwise
+ */
+int audio_path(char *buf, size_t len, const char *name)
+{
+    for (size_t i = 0; i < AUDIO_FORMAT_COUNT; i++)
+    {
+        snprintf(buf, len, AUDIO_DIR "/%s%s", name, AUDIO_FORMATS[i].ext);
+        if (access(buf, F_OK) == 0)
+        {
+            return 0;
+        }
+    }
+    snprintf(buf, len, AUDIO_DIR "/%s.mp3", name);
+    return -1;
+}
+
+/**
+ * Play an extracted audio track (replaces the calling process)
+ *
+ * This function uses an available media player to play the extracted audio file
+ * of a video. All output is redirected to /dev/null to avoid cluttering the
+ * terminal.
+ *
+ * @param audio_file Audio file, from audio_path()
+ */
+void play_audio(const char *audio_file)
+{
+    // Redirect output
+    int fd = open("/dev/null", O_RDWR);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    // Find available player
+    char* player = find_available_player();
+    if (!player) {
+        user_fatal("No media player found. Please install ffplay, mpv, or mplayer.");
+    }
+    
+    // Execute appropriate player with right arguments
+    if (strcmp(player, "ffplay") == 0) {
+        execlp(player, player, "-nodisp", "-autoexit", "-loglevel", "quiet", audio_file, NULL);
+    } else if (strcmp(player, "mpv") == 0) {
+        execlp(player, player, "--no-video", "--really-quiet", audio_file, NULL);
+    } else if (strcmp(player, "mplayer") == 0) {
+        execlp(player, player, "-novideo", "-really-quiet", audio_file, NULL);
+    } else if (strcmp(player, "vlc") == 0) {
+        execlp(player, player, "--intf", "dummy", "--no-video", audio_file, NULL);
+    }
+    
+    // If we get here, execution failed
+    fatal_error("Failed to play audio with %s", player);
+}
+
+/**
+ * Render a single ASCII art frame to the terminal
+ *
+ * This function writes the contents of an ASCII art frame to stdout,
+ * displaying a single frame of the ASCII video.
+ *
+ * @param frame Frame contents (as mapped by the frame cache)
+ * @param len Length of the frame in bytes
+ */
+void draw_ascii_frame(const char *frame, size_t len)
+{
+    // Validate frame is not NULL
+    if (frame == NULL)
+    {
+        fatal_error("Invalid frame provided, frame is NULL");
+    }
+
+    // Write the frame in one go and add a trailing newline
+    fwrite(frame, 1, len, stdout);
+    printf("\n");
+}
+
+/**
+ * Resolve the ASCII file drawn for a run of the current video (frame cache callback)
+ *
+ * The cache is keyed by run rather than by frame (see frameindex.h), so a run
+ * of identical frames is mapped once and read-ahead only covers frames that
+ * actually need drawing.
+ *
+ * @param index 1-based run number
+ * @param buf Output buffer for the path
+ * @param len Size of the output buffer
+ * @param opaque The video's frame index
+ * @return 0 if the run exists, -1 past the last run
+ */
+int ascii_frame_path(int index, char *buf, size_t len, void *opaque)
+{
+    const frame_index_t *idx = opaque;
+    if (index < 1 || index > idx->runs)
+    {
+        return -1;
+    }
+    frame_path(buf, len, ASCII_DIR, idx->run_frame[index - 1], ".txt");
+    return 0;
+}
+
+/**
+ * Current time on the monotonic clock in seconds
+ */
+double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Average frame rate of a video, for sizing read-ahead and pacing
+ *
+ * @param idx Frame index of the video
+ * @param fps Frame rate assumed for indexes without timestamps
+ * @return Frames per second, at least 1
+ */
+static int average_frame_rate(const frame_index_t *idx, int fps)
+{
+    double length = frame_index_time(idx, idx->count + 1, fps);
+    int rate = length > 0 ? (int)(idx->count / length + 0.5) : fps;
+    return rate > 0 ? rate : 1;
+}
+
+/* A converted video opened for playback (see draw_frames()) */
+struct playback
+{
+    char name[PATH_MAX];  /* Video name */
+    frame_index_t idx;    /* Its frame index */
+    frame_cache_t *cache; /* Frames mapped ahead of the playhead, NULL once closed */
+    int rate;             /* Average frame rate */
+    int audio_cue;        /* Pipe the audio player waits on before starting, -1 once cued */
+};
+
+/**
+ * Resolve the ASCII file drawn for a run of a video being played (frame cache callback)
+ *
+ * @param index 1-based run number
+ * @param buf Output buffer for the path
+ * @param len Size of the output buffer
+ * @param opaque The video's struct playback
+ * @return 0 if the run exists, -1 past the last run
+ */
+static int playback_frame_path(int index, char *buf, size_t len, void *opaque)
+{
+    const struct playback *pb = opaque;
+    if (index < 1 || index > pb->idx.runs)
+    {
+        return -1;
+    }
+    video_frame_path(buf, len, ASCII_DIR, pb->name, pb->idx.run_frame[index - 1], ".txt");
+    return 0;
+}
+
+/**
+ * Start a video's audio player, held back until its video starts
+ *
+ * The player process is forked now and waits on a pipe, with the audio file
+ * already read into the page cache, so that starting the audio is a single
+ * write() when the first frame goes up. Nothing is started without a player
+ * (headless playback).
+ *
+ * @param pb Video to prepare the audio of
+ */
+static void playback_prepare_audio(struct playback *pb)
+{
+    pb->audio_cue = -1;
+    int fds[2];
+    if (HEADLESS || pipe(fds) != 0)
+    {
+        return;
+    }
+    char audio_file[AUDIO_PATH_SIZE];
+    audio_path(audio_file, sizeof(audio_file), pb->name);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[1]);
+        int fd = open(audio_file, O_RDONLY);
+        if (fd != -1)
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+
+        // The pipe closes without a cue when the video is not played after all
+        char cue;
+        if (read(fds[0], &cue, 1) != 1)
+        {
+            _exit(EXIT_SUCCESS);
+        }
+        close(fds[0]);
+        play_audio(audio_file);
+    }
+    close(fds[0]);
+    if (pid == -1)
+    {
+        close(fds[1]);
+        return;
+    }
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC); // Not for the players of later videos
+    pb->audio_cue = fds[1];
+}
+
+/**
+ * Start a prepared audio player
+ *
+ * @param pb Video whose audio to start
+ */
+static void playback_cue_audio(struct playback *pb)
+{
+    if (pb->audio_cue == -1)
+    {
+        return;
+    }
+    char cue = 1;
+    if (write(pb->audio_cue, &cue, 1) != 1)
+    {
+        // The player is gone: the video plays on without sound
+    }
+    close(pb->audio_cue);
+    pb->audio_cue = -1;
+}
+
+/**
+ * Open a video for playback and get it ready to start
+ *
+ * Loads the frame index, creates the frame cache and, when `warm` is set,
+ * maps the first second of frames; the audio player is started and left
+ * waiting for its cue.
+ *
+ * @param pb Playback to fill in (its address must stay the same until closed)
+ * @param name Video name
+ * @param budget Memory budget of the frame cache (0 = no cap)
+ * @param keep Whether frames stay mapped once shown, for looping (see frame_cache_keep())
+ * @param warm Whether to map the first frames now
+ * @return 0 on success, -1 if the video has no frames
+ */
+static int playback_open(struct playback *pb, const char *name, size_t budget, int keep, int warm)
+{
+    snprintf(pb->name, sizeof(pb->name), "%s", name);
+    pb->audio_cue = -1;
+    if (load_frame_index(name, &pb->idx) != 0)
+    {
+        return -1;
+    }
+    pb->rate = average_frame_rate(&pb->idx, atoi(FPS));
+
+    // Read ahead up to one second of frames, as far as the budget allows
+    pb->cache = frame_cache_create(budget, pb->rate, playback_frame_path, pb);
+    if (pb->cache == NULL)
+    {
+        frame_index_free(&pb->idx);
+        return -1;
+    }
+    if (keep)
+    {
+        frame_cache_keep(pb->cache, pb->idx.runs);
+    }
+    frame_view_t first;
+    if (warm && frame_cache_get(pb->cache, 1, &first) == 0)
+    {
+        frame_cache_prefetch(pb->cache, 1);
+    }
+    playback_prepare_audio(pb);
+    return 0;
+}
+
+/**
+ * Close a video opened with playback_open()
+ *
+ * An audio player still waiting for its cue exits without playing.
+ *
+ * @param pb Playback to close
+ */
+static void playback_close(struct playback *pb)
+{
+    if (pb->audio_cue != -1)
+    {
+        close(pb->audio_cue);
+        pb->audio_cue = -1;
+    }
+    frame_cache_destroy(pb->cache);
+    pb->cache = NULL;
+    frame_index_free(&pb->idx);
+}
+
+/**
+ * Send a run's ASCII frame file straight to the output
+ *
+ * Writes the same bytes as draw_ascii_frame() with the frame start (see
+ * term.h) in front, but the frame itself is copied by the kernel from its
+ * file and never enters user space (see fdcopy.h).
+ *
+ * @param out Output prepared with fdcopy_init()
+ * @param pb Video being played
+ * @param run 1-based run to draw
+ * @param len Output: size of the frame in bytes
+ * @return 0 on success, -1 if the frame could not be read or written
+ */
+static int send_frame_file(fdcopy_t *out, struct playback *pb, int run, size_t *len)
+{
+    char path[PATH_MAX];
+    if (playback_frame_path(run, path, sizeof(path), pb) != 0)
+    {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    *len = (size_t)st.st_size;
+    const char *start = term_frame_start(*len);
+    const char *end = term_frame_end();
+    int rc = fdcopy_write(out, start, strlen(start)) == 0 &&
+                     fdcopy_send(out, fd, 0, *len) == 0 &&
+                     fdcopy_write(out, "\n", 1) == 0 &&
+                     fdcopy_write(out, end, strlen(end)) == 0
+                 ? 0
+                 : -1;
+    close(fd);
+    return rc;
+}
+
+/* Playback into an emulated terminal (--sink vt) */
+struct vt_sink
+{
+    vt_t *vt;            /* Created at the first frame, sized to fit it */
+    FILE *out;           /* Where the report goes: the original stdout */
+    int saved_stdout;    /* Original stdout, put back when playback ends */
+    int frames;          /* Frames drawn */
+    int mismatched;      /* Frames that left the screen different from their source */
+    int first_frame;     /* First of those, with its video and row */
+    int first_row;
+    char first_name[PATH_MAX];
+    size_t largest;      /* Most bytes written for one frame */
+};
+
+/**
+ * Send playback output to an emulated terminal instead of stdout
+ *
+ * Standard output is replaced by an anonymous temporary file, which takes
+ * every byte the player writes, whichever way it writes them (buffered, or
+ * copied kernel-side from the frame files). After each frame the bytes are
+ * applied to the terminal (see vt.h) and the file is emptied again. Frames
+ * are drawn back to back, without audio.
+ *
+ * @param sink Sink to open
+ */
+static void vt_sink_open(struct vt_sink *sink)
+{
+    *sink = (struct vt_sink){0};
+    fflush(stdout);
+    FILE *capture = tmpfile();
+    sink->saved_stdout = dup(STDOUT_FILENO);
+    if (capture == NULL || sink->saved_stdout == -1 || dup2(fileno(capture), STDOUT_FILENO) == -1 ||
+        (sink->out = fdopen(sink->saved_stdout, "w")) == NULL)
+    {
+        fatal_error("Cannot capture playback output: %s", strerror(errno));
+    }
+    fclose(capture); // Standard output holds the file now
+    HEADLESS = 1;
+}
+
+/**
+ * Apply everything written to the sink since the last call to its terminal
+ *
+ * @param sink Open sink
+ * @return Bytes applied, or -1 if the captured output could not be read
+ */
+static ssize_t vt_sink_apply(struct vt_sink *sink)
+{
+    fflush(stdout);
+    off_t end = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+    char chunk[BUFFER_SIZE * 64];
+    for (off_t at = 0; at < end;)
+    {
+        ssize_t n = pread(STDOUT_FILENO, chunk, sizeof(chunk), at);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        vt_write(sink->vt, chunk, (size_t)n);
+        at += n;
+    }
+    if (lseek(STDOUT_FILENO, 0, SEEK_SET) != 0 || ftruncate(STDOUT_FILENO, 0) != 0)
+    {
+        return -1;
+    }
+    return (ssize_t)end;
+}
+
+/**
+ * Take a frame the player has just written: apply it to the emulated
+ * terminal, record what it cost and check that the screen shows the frame
+ *
+ * One line per frame goes to the report: video, frame number, bytes written,
+ * escape sequences, and "ok" or the first row that differs.
+ *
+ * @param sink Open sink
+ * @param pb Video being played
+ * @param index 1-based frame just drawn
+ * @param run Its run in the frame index
+ * @param drawn The text the player drew (after any adaptive reduction), or
+ *              NULL if it was copied from the frame file untouched
+ * @param len Size of that text
+ * @return 0 on success, -1 if the frame or the captured output cannot be read
+ */
+static int vt_sink_frame(struct vt_sink *sink, struct playback *pb, int index, int run,
+                         const char *drawn, size_t len)
+{
+    frame_view_t source;
+    if (drawn == NULL)
+    {
+        if (frame_cache_get(pb->cache, run, &source) != 0)
+        {
+            return -1;
+        }
+        drawn = source.data;
+        len = source.len;
+    }
+
+    // A terminal big enough for the frame, plus the line its trailing newline opens
+    const char *nl = memchr(drawn, '\n', len);
+    int cols = (int)(nl ? (size_t)(nl - drawn) : len);
+    int rows = 2;
+    for (const char *p = drawn; (p = memchr(p, '\n', len - (size_t)(p - drawn))) != NULL; p++)
+    {
+        rows++;
+    }
+    cols = cols > 0 ? cols : 1;
+    if (sink->vt == NULL)
+    {
+        sink->vt = vt_create(rows, cols);
+    }
+    else if (rows > vt_rows(sink->vt) || cols > vt_cols(sink->vt))
+    {
+        vt_resize(sink->vt, rows > vt_rows(sink->vt) ? rows : vt_rows(sink->vt),
+                  cols > vt_cols(sink->vt) ? cols : vt_cols(sink->vt));
+    }
+    if (sink->vt == NULL)
+    {
+        fatal_error("Memory allocation failed for the emulated terminal");
+    }
+
+    vt_stats_t before = vt_stats(sink->vt);
+    ssize_t bytes = vt_sink_apply(sink);
+    if (bytes < 0)
+    {
+        return -1;
+    }
+    vt_stats_t after = vt_stats(sink->vt);
+    int row = vt_compare(sink->vt, drawn, len);
+
+    sink->frames++;
+    if ((size_t)bytes > sink->largest)
+    {
+        sink->largest = (size_t)bytes;
+    }
+    if (row != 0 && sink->mismatched++ == 0)
+    {
+        sink->first_frame = index;
+        sink->first_row = row;
+        snprintf(sink->first_name, sizeof(sink->first_name), "%s", pb->name);
+    }
+    fprintf(sink->out, "%s\t%d\t%zd\t%zu\t", pb->name, index, bytes, after.escapes - before.escapes);
+    row == 0 ? fprintf(sink->out, "ok\n") : fprintf(sink->out, "row %d\n", row);
+    return 0;
+}
+
+/**
+ * Finish playback into an emulated terminal: take the output written after
+ * the last frame, put stdout back and report the totals
+ *
+ * @param sink Open sink
+ * @return Number of frames that did not match their source
+ */
+static int vt_sink_close(struct vt_sink *sink)
+{
+    if (sink->vt != NULL)
+    {
+        vt_sink_apply(sink);
+    }
+    fflush(stdout);
+    dup2(sink->saved_stdout, STDOUT_FILENO);
+    fclose(sink->out);
+
+    vt_stats_t total = sink->vt ? vt_stats(sink->vt) : (vt_stats_t){0};
+    int frames = sink->frames > 0 ? sink->frames : 1;
+    fprintf(stderr, "VT sink: %d frames drawn, %zu bytes written (%.0f per frame, largest %zu)\n",
+            sink->frames, total.bytes, (double)total.bytes / frames, sink->largest);
+    fprintf(stderr, "VT sink: %zu escape sequences (%.1f per frame, %zu not modeled), %zu lines scrolled\n",
+            total.escapes, (double)total.escapes / frames, total.unknown, total.scrolls);
+    if (sink->mismatched == 0)
+    {
+        fprintf(stderr, "VT sink: every frame matched its source on screen\n");
+    }
+    vt_destroy(sink->vt);
+    return sink->mismatched;
+}
+
+/**
+ * Draw ASCII frames in sequence to create video playback
+ *
+ * This function creates the visual playback by displaying ASCII art frames
+ * in the terminal at the specified frame rate. It:
+ * 1. Walks the numbered frame files of each video of the playlist (or of the
+ *    current video) in order, starting each video's audio with its first frame
+ * 2. Clears the screen before starting playback (on a terminal, switches to
+ *    the alternate screen instead, see term.h)
+ * 3. Displays each frame with appropriate timing between frames, each one
+ *    drawn over the last without clearing the screen on a terminal, and
+ *    bracketed as one synchronized update where the terminal supports it
+ * 4. Shows each frame at the time recorded for it in the frame index (the
+ *    FPS grid, or the source's own timestamps for VFR conversions), against
+ *    absolute deadlines so that slow frames do not delay the rest of the video
+ *
+ * Frames come from a frame cache (see framecache.h) that maps up to one second
+ * of frames ahead of the playhead, evicting frames already shown so that no
+ * more than MEM_BUDGET bytes are ever mapped. Peak memory therefore stays flat
+ * however long the video is, and is reported when playback ends.
+ *
+ * Videos of a playlist follow each other without a gap: as soon as one video
+ * is on screen, the next one's frame index is loaded, its first second of
+ * frames mapped and its audio player started and held back, so the next video
+ * starts on the very deadline the last frame of the current one ends. With
+ * --loop the playlist starts over when it ends, every video stays open, and
+ * their frames stay mapped between rounds as far as a share of the budget
+ * allows, so later rounds draw from memory instead of reading the files again.
+ *
+ * In adaptive mode (--adaptive) the time each frame takes to be accepted by
+ * stdout is measured, and when the terminal or link cannot keep up, frames are
+ * skipped and then drawn at reduced resolution (see adaptive.h) so playback
+ * stays in real time. Frames whose slot has already passed are dropped.
+ *
+ * A frame identical to the one already on screen (per the frame index) is not
+ * redrawn: the player sleeps straight through to the next different frame.
+ * Ctrl+C ends playback after the frame on screen.
+ *
+ * With --sink vt, the output goes to an emulated terminal instead, as it
+ * would to a real one, and every frame is checked against the screen (see
+ * vt_sink_open()).
+ */
+void draw_frames()
+{
+    struct vt_sink sink;
+    if (VT_SINK)
+    {
+        vt_sink_open(&sink);
+    }
+
+    size_t budget = 0;
+    parse_size(MEM_BUDGET, &budget);
+    int fps = atoi(FPS); // Frame rate of videos indexed without timestamps
+
+    // The playlist, or just the current video
+    char *single[] = {VIDEO_NAME};
+    char **names = PLAYLIST_COUNT > 0 ? PLAYLIST : single;
+    int count = PLAYLIST_COUNT > 0 ? PLAYLIST_COUNT : 1;
+
+    // Output that is not a terminal is fed straight from the frame files by
+    // the kernel (adaptive mode needs the bytes in hand to downsample them)
+    fdcopy_t out;
+    int zero_copy = !ADAPTIVE && fdcopy_init(&out, STDOUT_FILENO) == 0;
+
+    // A looping playlist keeps every video open, with a share of the budget each
+    size_t item_budget = LOOP && budget ? (budget / count > 0 ? budget / count : 1) : budget;
+    struct playback *items = calloc(count, sizeof(*items));
+    if (items == NULL)
+    {
+        fatal_error("Memory allocation failed for playlist");
+    }
+    if (playback_open(&items[0], names[0], item_budget, LOOP, !zero_copy) != 0)
+    {
+        fatal_error("No ASCII frames found for %s", names[0]);
+    }
+
+    // Throughput tracking and scratch space for downsampled frames
+    adaptive_t pace;
+    adaptive_init(&pace, items[0].rate);
+    char *scratch = NULL;
+    size_t scratch_size = 0;
+    int skipped = 0, reduced = 0, unchanged = 0, total = 0;
+    size_t peak = 0;
+
+    // Take over the terminal, or clear the screen before starting playback
+    // (ANSI escape sequence)
+    fflush(stdout);
+    if (VT_SINK ? !term_begin_emulated(STDOUT_FILENO) : HEADLESS || !term_begin(STDOUT_FILENO))
+    {
+        printf("\033[2J\033[1;1H");
+        fflush(stdout);
+    }
+
+    // Play each video in turn, each starting where the previous one ended
+    int frame_count = 0;
+    int failed = 0;
+    int item = 0;
+    double start = now_seconds();
+    frame_view_t frame;
+    for (;;)
+    {
+        struct playback *pb = &items[item];
+        int upcoming = item + 1 < count ? item + 1 : LOOP ? 0 : -1;
+        int prepared = upcoming == -1;
+        mark_played(pb->name);
+        total += pb->idx.count;
+
+        // Process each frame in order
+        int index = 1;
+        while (index <= pb->idx.count && !sigint_received)
+        {
+            int run = pb->idx.run[index - 1];
+            double write_start = now_seconds();
+            const char *drawn = NULL; // Text drawn from memory, if it was
+            size_t len;
+            if (zero_copy)
+            {
+                if (send_frame_file(&out, pb, run, &len) != 0)
+                {
+                    failed = 1;
+                    break;
+                }
+            }
+            else if (frame_cache_get(pb->cache, run, &frame) != 0)
+            {
+                failed = 1;
+                break;
+            }
+            else
+            {
+                // Reduce resolution if the measured throughput calls for it
+                const char *data = frame.data;
+                len = frame.len;
+                if (ADAPTIVE)
+                {
+                    adaptive_update(&pace, len);
+                    if (pace.factor > 1)
+                    {
+                        if (scratch_size < len)
+                        {
+                            free(scratch);
+                            scratch = malloc(len);
+                            scratch_size = scratch ? len : 0;
+                        }
+                        if (scratch)
+                        {
+                            len = adaptive_downsample(frame.data, frame.len, pace.factor, scratch);
+                            data = scratch;
+                            reduced++;
+                        }
+                    }
+                }
+
+                // Home the cursor, or clear the screen, before each frame
+                fputs(term_frame_start(len), stdout);
+
+                // Draw the current frame to the terminal, as one update
+                draw_ascii_frame(data, len);
+                fputs(term_frame_end(), stdout);
+                fflush(stdout);
+                drawn = data;
+            }
+            if (VT_SINK && vt_sink_frame(&sink, pb, index, run, drawn, len) != 0)
+            {
+                failed = 1;
+                break;
+            }
+            if (index == 1)
+            {
+                playback_cue_audio(pb); // The video is on screen: start its sound
+            }
+            adaptive_record(&pace, len, now_seconds() - write_start);
+            frame_count++;
+
+            // Queue upcoming frames while this one is on screen
+            if (!zero_copy)
+            {
+                frame_cache_prefetch(pb->cache, run);
+            }
+
+            // Get the next video ready while this one plays: open it, or (when
+            // looping) just hold another audio player ready for it
+            if (!prepared)
+            {
+                struct playback *next = &items[upcoming];
+                if (next->cache == NULL &&
+                    playback_open(next, names[upcoming], item_budget, LOOP, !zero_copy) != 0)
+                {
+                    fatal_error("No ASCII frames found for %s", names[upcoming]);
+                }
+                else if (next->audio_cue == -1)
+                {
+                    playback_prepare_audio(next);
+                }
+                prepared = 1;
+            }
+
+            // Pick the next frame: the adaptive ladder may skip some, and any
+            // whose display slot has already passed are dropped
+            int next = index + (ADAPTIVE ? pace.stride : 1);
+            if (ADAPTIVE)
+            {
+                int due = frame_index_at(&pb->idx, now_seconds() - start, fps);
+                if (due > next)
+                {
+                    next = due;
+                }
+            }
+            skipped += next - index - 1;
+
+            // Frames identical to the one on screen need no redraw
+            while (next <= pb->idx.count && pb->idx.run[next - 1] == run)
+            {
+                next++;
+                unchanged++;
+            }
+            index = next;
+
+            // Sleep until the next frame is due (or the last one has had its time)
+            double deadline = start + frame_index_time(&pb->idx, index, fps);
+            struct timespec ts = {
+                .tv_sec = (time_t)deadline,                                 // Seconds part
+                .tv_nsec = (long)((deadline - (time_t)deadline) * 1e9)      // Nanoseconds part
+            };
+            while (!HEADLESS && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR &&
+                   !sigint_received)
+            {
+                // A resize is no reason to show the next frame early
+            }
+        }
+
+        // The next video starts on the deadline this one ends
+        start += frame_index_time(&pb->idx, pb->idx.count + 1, fps);
+        if (frame_cache_peak(pb->cache) > peak)
+        {
+            peak = frame_cache_peak(pb->cache);
+        }
+        if (!LOOP)
+        {
+            playback_close(pb);
+        }
+        if (upcoming == -1 || failed || sigint_received)
+        {
+            break;
+        }
+        item = upcoming;
+    }
+
+    // Report memory use and adaptation once playback is complete, back on
+    // the normal screen
+    for (int i = 0; i < count; i++)
+    {
+        if (items[i].cache != NULL)
+        {
+            playback_close(&items[i]);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fflush(stdout);
+    term_end();
+    fprintf(stderr, "Peak RSS: %ld KiB, peak frames mapped: %zu KiB (budget: %s)\n",
+            usage.ru_maxrss, peak / 1024, budget ? MEM_BUDGET : "unlimited");
+    fprintf(stderr, "Redraws skipped: %d of %d frames were identical to the one on screen\n",
+            unchanged, total);
+    if (zero_copy)
+    {
+        fprintf(stderr, "Output: frames copied from their files kernel-side (%s)\n", fdcopy_method(&out));
+    }
+    if (ADAPTIVE)
+    {
+        fprintf(stderr, "Adaptive: %d frames drawn, %d skipped, %d at reduced resolution, ~%.0f KiB/s accepted\n",
+                frame_count, skipped, reduced, pace.rate / 1024);
+    }
+    free(scratch);
+    free(items);
+
+    // Let the audio of the last video finish
+    while (!HEADLESS && (wait(NULL) > 0 || errno == EINTR))
+    {
+    }
+
+    int mismatched = VT_SINK ? vt_sink_close(&sink) : 0;
+    if (mismatched > 0)
+    {
+        user_fatal("VT sink: %d frames differed from their source on screen, the first at row %d of frame %d of %s",
+                   mismatched, sink.first_row, sink.first_frame, sink.first_name);
+    }
+}
+
+/**
+ * Export the current video as a pre-rendered, timed terminal stream
+ *
+ * Writes exactly the bytes playback would send to the terminal (screen clear
+ * plus frame, one chunk per frame) with the time each is due, so that
+ * --replay can later reproduce playback without reading frame files or doing
+ * any rendering. The format follows the file name (see timedstream.h):
+ * ".cast" gives asciicast v2, anything else the compact binary stream.
+ * Like playback, a run of identical frames is written once.
+ *
+ * @param path File to write the recording to
+ */
+void export_frames(const char *path)
+{
+    if (is_directory_empty(ASCII_DIR) || !video_extracted(VIDEO_NAME))
+    {
+        user_fatal("%s doesn't exist, try inserting a new one with -i <video_path>", VIDEO_NAME);
+    }
+    mark_played(VIDEO_NAME);
+
+    int fps = atoi(FPS);
+    frame_index_t idx;
+    frame_cache_t *cache = NULL;
+    frame_view_t frame;
+    if (load_frame_index(VIDEO_NAME, &idx) != 0 ||
+        (cache = frame_cache_create(0, 0, ascii_frame_path, &idx)) == NULL ||
+        frame_cache_get(cache, 1, &frame) != 0)
+    {
+        fatal_error("Failed to read the first frame of %s", VIDEO_NAME);
+    }
+
+    // Terminal size for the asciicast header: the first frame's widest line
+    // and line count, plus the newline playback adds after each frame
+    int cols = 0, rows = 1, line = 0;
+    for (size_t i = 0; i < frame.len; i++)
+    {
+        if (frame.data[i] == '\n')
+        {
+            rows++;
+            line = 0;
+        }
+        else if (++line > cols)
+        {
+            cols = line;
+        }
+    }
+
+    tstream_writer_t *out = tstream_open(path, tstream_format_for_path(path), cols, rows);
+    if (out == NULL)
+    {
+        user_fatal("Cannot create %s: %s", path, strerror(errno));
+    }
+
+    // One chunk per run: the same clear, frame and newline that draw_frames writes
+    static const char clear[] = "\033[2J\033[1;1H";
+    char *chunk = NULL;
+    size_t chunk_size = 0;
+    int run = 1;
+    int failed = 0;
+    do
+    {
+        size_t len = sizeof(clear) - 1 + frame.len + 1;
+        if (len > chunk_size)
+        {
+            free(chunk);
+            chunk = malloc(len);
+            chunk_size = chunk ? len : 0;
+            if (chunk == NULL)
+            {
+                fatal_error("Memory allocation failed for export buffer");
+            }
+        }
+        memcpy(chunk, clear, sizeof(clear) - 1);
+        memcpy(chunk + sizeof(clear) - 1, frame.data, frame.len);
+        chunk[len - 1] = '\n';
+
+        failed = tstream_write(out, frame_index_time(&idx, idx.run_start[run - 1], fps), chunk, len) != 0;
+        run++;
+    } while (!failed && frame_cache_get(cache, run, &frame) == 0);
+
+    free(chunk);
+    frame_cache_destroy(cache);
+    if (tstream_close(out) != 0 || failed)
+    {
+        fatal_error("Failed to write %s", path);
+    }
+    user_success("Exported %d frames (%d distinct draws) of %s to %s", idx.count, run - 1, VIDEO_NAME, path);
+    frame_index_free(&idx);
+}
+
+/**
+ * Check if a video has been properly extracted and is ready for playback
+ *
+ * This function verifies that all necessary assets (audio and ASCII frames)
+ * exist for a video before attempting playback. Both are looked up by name,
+ * without listing the asset directories.
+ *
+ * @param name Video name
+ * @return true if all video assets are available, false otherwise
+ */
+int video_extracted(const char *name)
+{
+    char audio_file[AUDIO_PATH_SIZE];
+    char first_frame[PATH_MAX];
+    video_frame_path(first_frame, sizeof(first_frame), ASCII_DIR, name, 1, ".txt");
+
+    // Check all necessary conditions:
+    // 1. The audio file exists, in any of the containers it may be in
+    // 2. The first ASCII frame exists (every later one may repeat it)
+    if (audio_path(audio_file, sizeof(audio_file), name) != 0 ||
+        access(first_frame, F_OK) != 0)
+    {
+        return false; // Missing required assets
     }
 
     return true; // All required assets are available
 }
 
 /**
- * Check if a directory contains files matching a specified pattern
+ * Check if a directory contains files matching a specified pattern
+ *
+ * This function examines a directory to determine if it contains any files
+ * that match the specified pattern. The pattern can include wildcards
+ * and is processed using fnmatch.
+ *
+ * @param dir_path Path to the directory to check
+ * @param file_name File name pattern to match (can include wildcards)
+ * @return true if a matching file exists, false otherwise
+ */
+int dir_contains(const char *dir_path, const char *file_name)
+{
+    // Validate input parameters
+    if (dir_path == NULL || file_name == NULL)
+    {
+        return false;
+    }
+
+    // Open the directory
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL)
+    {
+        return false; // Directory doesn't exist or can't be accessed
+    }
+
+    // Iterate through directory entries
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        // Check if the current entry matches the pattern
+        // fnmatch allows for wildcards and pattern matching
+        if (fnmatch(file_name, entry->d_name, 0) == 0)
+        {
+            closedir(dir);
+            return true; // Found a matching file
+        }
+    }
+
+    // Clean up and return false if no match was found
+    closedir(dir);
+    return false;
+}
+/**
+ * Play the ASCII video with synchronized audio
+ *
+ * This function plays the videos named with -p in order (or the current
+ * VIDEO_NAME) by:
+ * 1. Checking that every one of them has been properly extracted, before
+ *    the first one starts
+ * 2. Drawing their frames, which also starts each video's audio player in
+ *    step with its first frame (see draw_frames())
+ *
+ * If a video hasn't been extracted (except for the default video), or the
+ * daemon is still converting it, the function will exit with an error message.
+ */
+void play()
+{
+    // Verify the videos exist and have been properly extracted
+    // Skip this check for the default video which may be pre-installed
+    if (is_directory_empty(ASCII_DIR))
+    {
+        user_fatal("No ASCII art frames found. Please extract video using -i <video_path> first.");
+    }
+    for (int i = 0; i < (PLAYLIST_COUNT > 0 ? PLAYLIST_COUNT : 1); i++)
+    {
+        const char *name = PLAYLIST_COUNT > 0 ? PLAYLIST[i] : VIDEO_NAME;
+        if (video_converting(name))
+        {
+            user_fatal("%s is still being converted by the daemon (see --status)", name);
+        }
+        if (!video_extracted(name) && strcmp(name, DEFAULT_VIDEO_NAME) != 0)
+        {
+            user_fatal("%s doesn't exist, try inserting a new one with -i <video_path>", name);
+        }
+    }
+
+    // Into an emulated terminal, playback would never end
+    if (VT_SINK && LOOP)
+    {
+        user_fatal("--sink vt plays each video once; drop --loop");
+    }
+
+    // Don't let the audio players inherit (and repeat) pending output
+    fflush(stdout);
+
+    // Ask the terminal about synchronized output before the audio player
+    // may start reading from it
+    term_probe(STDOUT_FILENO);
+
+    draw_frames();
+}
+
+/**
+ * Check whether an input is a live stream rather than a video file
+ *
+ * "-" (standard input) and named pipes can only be read once, front to back,
+ * as the producer writes them: they can be neither probed nor seeked.
+ *
+ * @param path Input given to -i
+ * @return 1 for a live stream, 0 otherwise
+ */
+int is_live_input(const char *path)
+{
+    struct stat st;
+    return strcmp(path, "-") == 0 || (stat(path, &st) == 0 && S_ISFIFO(st.st_mode));
+}
+
+/**
+ * Convert and show a live input as it arrives
+ *
+ * One ffmpeg decodes the stream (at its own pace with -re, so a producer
+ * that writes faster than real time is played in real time) and writes gray
+ * frames down a pipe; each frame is rendered to ASCII in memory and drawn
+ * straight away. Nothing is written to disk, and there is no audio.
+ *
+ * Frames are taken off the pipe by a reader thread (see livefeed.h), so a
+ * slow terminal never backs up into the decoder or the producer. At most
+ * MAX_LATENCY worth of frames wait to be drawn, and frames that have waited
+ * longer than MAX_LATENCY are dropped rather than shown late. Playback ends
+ * with the stream, or on Ctrl+C.
+ */
+void play_live()
+{
+    int fps = atoi(FPS);
+    double max_latency = atoi(MAX_LATENCY) / 1000.0;
+    int capacity = (int)(max_latency * fps) + 1;
+
+    // Decode with as little buffering as ffmpeg allows
+    char vf[FILTER_SIZE];
+    snprintf(vf, sizeof(vf), "fps=%s,scale=%s:-1,format=gray", FPS, WIDTH);
+    char *args[] = {"ffmpeg", "-loglevel", "quiet", "-nostdin",
+                    "-fflags", "nobuffer", "-flags", "low_delay", "-re",
+                    "-i", strcmp(VIDEO_PATH, "-") == 0 ? "pipe:0" : VIDEO_PATH,
+                    "-map", "0:v:0", "-an", "-vf", vf,
+                    "-c:v", "pgm", "-f", "image2pipe", "-flush_packets", "1", "pipe:1", NULL};
+
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        fatal_error("Failed to create pipe: %s", strerror(errno));
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        fatal_error("Fork failed: %s", strerror(errno));
+    }
+    if (pid == 0)
+    {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execvp("ffmpeg", args);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    live_feed_t *feed = live_feed_start(fds[0], capacity);
+    if (feed == NULL)
+    {
+        kill(pid, SIGTERM);
+        fatal_error("Failed to start reading the live stream");
+    }
+
+    sm_context_t render;
+    render_context(&render);
+    char *text = NULL;
+    size_t text_size = 0;
+
+    if (!term_begin(STDOUT_FILENO))
+    {
+        printf("\033[2J\033[1;1H");
+        fflush(stdout);
+    }
+
+    size_t shown = 0;
+    double worst = 0;
+    gray_image_t img;
+    while (!sigint_received && live_feed_next(feed, max_latency, &img) == 1)
+    {
+        size_t len;
+        if (sm_render(&render, &img, text, text_size, &len) == SM_ERR_BUFFER)
+        {
+            free(text);
+            text = malloc(len);
+            text_size = text ? len : 0;
+            if (text == NULL || sm_render(&render, &img, text, text_size, &len) != SM_OK)
+            {
+                break;
+            }
+        }
+
+        fputs(term_frame_start(len), stdout);
+        draw_ascii_frame(text, len);
+        fputs(term_frame_end(), stdout);
+        fflush(stdout);
+
+        // From leaving the decoder to being on screen
+        double latency = live_feed_age(feed);
+        if (latency > worst)
+        {
+            worst = latency;
+        }
+        shown++;
+    }
+
+    // Stop the decoder (if it is still running) so the reader sees the end
+    kill(pid, SIGTERM);
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    size_t received = live_feed_received(feed);
+    size_t dropped = live_feed_dropped(feed);
+    live_feed_stop(feed);
+    sm_release(&render);
+    free(text);
+
+    fflush(stdout);
+    term_end();
+    if (received == 0)
+    {
+        user_fatal("No video frames received from %s", VIDEO_PATH);
+    }
+    fprintf(stderr, "Live: %zu of %zu frames shown, %zu dropped to stay within %s ms (worst latency: %.0f ms)\n",
+            shown, received, dropped, MAX_LATENCY, worst * 1000);
+}
+
+/**
+ * Empty the directory open on a descriptor, then close it
+ *
+ * Entries are removed relative to the directory descriptor. Each one is
+ * unlinked straight away, and only when that fails because it is a
+ * directory is it emptied and removed in turn, so no entry needs a stat().
+ *
+ * @param fd Descriptor of the directory (taken over and closed)
+ */
+static void empty_directory_fd(int fd)
+{
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL)
+    {
+        close(fd);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        // Skip the special directories "." and ".."
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+
+        // Linux reports EISDIR (POSIX allows EPERM) for a directory
+        if (unlinkat(dirfd(dir), entry->d_name, 0) == 0 || (errno != EISDIR && errno != EPERM))
+        {
+            continue;
+        }
+        int sub = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (sub != -1)
+        {
+            empty_directory_fd(sub);
+            unlinkat(dirfd(dir), entry->d_name, AT_REMOVEDIR);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * Empty a directory by removing all its files and subdirectories
+ *
+ * This function recursively removes all contents of the specified directory
+ * without removing the directory itself (see empty_directory_fd()).
+ *
+ * @param dir_name Path to the directory to be emptied
+ */
+void empty_directory(const char *dir_name)
+{
+    // Validate input parameter
+    if (dir_name == NULL)
+    {
+        fatal_error("Invalid directory name provided, path is NULL");
+    }
+
+    int fd = open(dir_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1)
+    {
+        empty_directory_fd(fd);
+    }
+}
+
+/**
+ * Create a directory if it doesn't already exist
+ *
+ * This function checks if the specified directory exists, and if not,
+ * creates it with standard permissions (0755 = rwxr-xr-x).
+ *
+ * @param dir_name Path to the directory to create
+ */
+void create_dir(const char *dir_name)
+{
+    // Validate input parameter
+    if (dir_name == NULL)
+    {
+        fatal_error("Invalid directory name provided, path is NULL");
+    }
+
+    // Check if directory already exists
+    struct stat st = {0};
+    if (stat(dir_name, &st) != 0)
+    {
+        // Directory doesn't exist, create it with permissions 0755 (rwxr-xr-x)
+        if (mkdir(dir_name, 0755) == -1)
+        {
+            // Handle directory creation failure
+            fatal_error("Failed to create directory: %s (Error: %s)",
+                        dir_name, strerror(errno));
+        }
+    }
+    // If directory already exists, nothing needs to be done
+}
+/**
+ * Generate a detailed usage message with instructions and examples
+ *
+ * This function creates a formatted help message that describes all available
+ * command-line options with their defaults and provides usage examples.
+ * The returned string must be freed by the caller to prevent memory leaks.
+ *
+ * @param program_name The name of the program (usually argv[0])
+ * @return A dynamically allocated string containing the usage message
+ */
+char *get_usage_msg(const char *program_name)
+{
+    // Allocate memory for the usage message
+    char *usage = malloc(BUFFER_SIZE * 4); // Allocate enough space for the message
+    if (usage == NULL)
+    {
+        fatal_error("Memory allocation failed for usage message");
+    }
+
+    // Format the string with program_name and default values
+    // This includes all command-line options, their descriptions, defaults, and examples
+    snprintf(usage, BUFFER_SIZE * 4,
+             "Usage: %s [OPTIONS]\n\n"
+             "Options:\n"
+             "  -i, --input FILE       Path to a video file to process. Repeat it, or pass a\n"
+             "                         directory or quoted pattern, to convert a batch;\n"
+             "                         - or a FIFO plays a live stream as it arrives\n"
+             "  -j, --jobs N           Inputs converted at once in batch mode (default: one per\n"
+             "                         CPU); each still runs its own ffmpeg processes\n"
+             "      --segments N       Extract frames of long videos in N parallel time segments\n"
+             "  -f, --fps N            Frames per second (default: %s)\n"
+             "  -w, --width N          Width in characters (default: %s)\n"
+             "  -t, --height N         Height in characters (default: %s)\n"
+             "  -s, --start TIME       Start time in HH:MM:SS format (default: %s)\n"
+             "  -d, --duration SEC     Duration in seconds (default: full video)\n"
+             "      --dither MODE      Glyph quantization: none or bayer (default: %s)\n"
+             "      --stabilize N      Keep a cell's glyph until its luma moves N (0-255) past\n"
+             "                         the glyph's range, against flicker (default: 0, off)\n"
+             "      --single-pass      Decode the video once for both audio and frames\n"
+             "      --vfr              Keep the source's frames and timing instead of resampling\n"
+             "                         to -f (for variable frame rate video)\n"
+             "      --mem-budget SIZE  Cap on frame memory during playback, e.g. 32M (default: %s)\n"
+             "      --disk-budget SIZE Cap on disk used by converted videos, e.g. 2G; the least\n"
+             "                         recently played are evicted (default: none, or $SM_DISK_BUDGET)\n"
+             "      --max-latency MS   Drop live frames that wait longer than MS (default: %s)\n"
+             "      --adaptive         Skip frames and lower resolution when output can't keep up\n"
+             "      --export FILE      Write the rendered playback to FILE instead of playing it\n"
+             "                         (asciicast v2 if FILE ends in .cast, else binary)\n"
+             "      --sink MODE        Playback output: tty, or vt to play into an emulated\n"
+             "                         terminal, check every frame and report its bytes (default: tty)\n"
+             "      --replay FILE      Replay a file written by --export (no audio)\n"
+             "      --bench FRAMES     Time conversion and headless playback of a synthetic\n"
+             "                         video at the given width (stdout gets the frames)\n"
+             "      --daemon           Run a background conversion service (-j jobs at once)\n"
+             "      --async            With -i, queue the conversion with the daemon and return\n"
+             "      --priority N       Priority of queued conversions, higher first (default: 0)\n"
+             "      --status           List the daemon's queued, running and finished jobs\n"
+             "  -p, --play NAME        Play a previously converted video by name; repeat it for\n"
+             "                         a playlist, played without gaps\n"
+             "      --loop             Start the video or playlist over when it ends\n"
+             "  -r, --reset            Reset all settings and delete all extracted files\n"
+             "                         WARNING: This will permanently delete all videos!\n"
+             "  -h, --help             Display this help message\n\n"
+             "Examples:\n"
+             "  %s -p rr               Play the default \"rickroll\" video\n"
+             "  %s -i video.mp4        Convert and play a new video\n"
+             "  %s -i video.mp4 -s 00:01:30 -d 10  Start at 1:30, play for 10 seconds\n"
+             "  %s --export rr.cast -p rr  Pre-render rr for replay\n",
+             program_name, DEFAULT_FPS, DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_START_TIME,
+             DEFAULT_DITHER, DEFAULT_MEM_BUDGET, DEFAULT_MAX_LATENCY, program_name, program_name, program_name, program_name);
+
+    return usage;
+}
+
+/**
+ * Append the ffmpeg arguments that select the input window
+ *
+ * Quiet logging, no stdin, then START_TIME and (if non-zero) DURATION as input
+ * options, so that every output of the command sees the same window.
+ *
+ * @param args Argument vector being built
+ * @param n Number of arguments already in the vector
+ * @return New argument count
+ */
+static int add_input_args(char **args, int n)
+{
+    // Basic ffmpeg setup with quiet logging and input file
+    args[n++] = "ffmpeg";
+    args[n++] = "-loglevel";
+    args[n++] = "quiet";
+    args[n++] = "-nostdin";
+    args[n++] = "-ss";
+    args[n++] = START_TIME; // Starting timestamp from config
+
+    // Add duration parameter if specified (non-zero)
+    if (atoi(DURATION) > 0)
+    {
+        args[n++] = "-t";
+        args[n++] = DURATION;
+    }
+
+    args[n++] = "-i";
+    args[n++] = VIDEO_PATH; // Input video path
+    return n;
+}
+
+/**
+ * Build the path the current video's audio is extracted to and clear the way for it
+ *
+ * The audio is written to the conversion's working directory and only moved
+ * into AUDIO_DIR once the whole conversion is done (see commit_conversion()).
+ * Audio files of the video left in other containers are removed, so that a
+ * stale one cannot be found instead of the new one.
+ *
+ * @param buf Output buffer for the path
+ * @param len Size of the output buffer
+ * @param ext Extension of the audio file
+ */
+static void audio_output_path(char *buf, size_t len, const char *ext)
+{
+    for (size_t i = 0; i < AUDIO_FORMAT_COUNT; i++)
+    {
+        snprintf(buf, len, AUDIO_DIR "/%s%s", VIDEO_NAME, AUDIO_FORMATS[i].ext);
+        unlink(buf);
+    }
+    snprintf(buf, len, "%s/%s%s", WORK_DIR, VIDEO_NAME, ext);
+}
+
+/**
+ * Append the ffmpeg arguments for the audio output
+ *
+ * @param args Argument vector being built
+ * @param n Number of arguments already in the vector
+ * @param out Output audio file path, from audio_output_path()
+ * @param copy Whether to stream-copy the audio rather than encode it to MP3
+ * @return New argument count
+ */
+static int add_audio_output_args(char **args, int n, char *out, int copy)
+{
+    // Audio extraction parameters
+    args[n++] = "-map";           // First audio stream only
+    args[n++] = "0:a:0";
+    args[n++] = "-vn";            // No video
+    if (copy)
+    {
+        args[n++] = "-acodec";    // Audio codec
+        args[n++] = "copy";       // Keep the packets as they are
+    }
+    else
+    {
+        args[n++] = "-acodec";    // Audio codec
+        args[n++] = "libmp3lame"; // Use MP3 encoder
+        args[n++] = "-q:a";       // Audio quality
+        args[n++] = "2";          // High quality (0-9, lower is better)
+    }
+    args[n++] = out;              // Output file path
+    return n;
+}
+
+/**
+ * Backslash-escape characters of a string
+ *
+ * @param in String to escape
+ * @param special Characters to escape (the backslash should be one of them)
+ * @param out Output buffer
+ * @param len Size of the output buffer
+ * @return 0 on success, -1 if the output did not fit
+ */
+static int escape_chars(const char *in, const char *special, char *out, size_t len)
+{
+    size_t n = 0;
+    for (; *in != '\0'; in++)
+    {
+        if (strchr(special, *in) != NULL)
+        {
+            if (n + 1 >= len)
+            {
+                return -1;
+            }
+            out[n++] = '\\';
+        }
+        if (n + 1 >= len)
+        {
+            return -1;
+        }
+        out[n++] = *in;
+    }
+    out[n] = '\0';
+    return 0;
+}
+
+/**
+ * Append the ffmpeg arguments for the numbered grayscale frame output
+ *
+ * In VFR mode every source frame in the window is written, with no frame
+ * rate conversion, and a metadata filter logs each frame's timestamp (in
+ * seconds from the start time) to the video's timestamp log, one entry per
+ * frame in output order. The log is written unbuffered and ahead of the
+ * frame itself, so a frame's timestamp is always in the log by the time its
+ * file appears.
+ *
+ * @param args Argument vector being built
+ * @param n Number of arguments already in the vector
+ * @param vf Buffer of FILTER_SIZE bytes to hold the filter graph
+ * @param pattern Output file pattern containing %04d
+ * @return New argument count
+ */
+static int add_frames_output_args(char **args, int n, char *vf, char *pattern)
+{
+    if (VFR)
+    {
+        // The log path is an option value inside a filter graph: escape it for both
+        char log[PATH_MAX], quoted[2 * PATH_MAX], escaped[4 * PATH_MAX];
+        pts_log_path(log, sizeof(log), VIDEO_NAME);
+        escape_chars(log, "\\':", quoted, sizeof(quoted));
+        escape_chars(quoted, "\\'[],;", escaped, sizeof(escaped));
+        snprintf(vf, FILTER_SIZE,
+                 "metadata=mode=add:key=sm:value=1,metadata=mode=print:key=sm:file=%s:direct=1,"
+                 "scale=%s:-1,format=gray",
+                 escaped, WIDTH);
+    }
+    else
+    {
+        // Video filter chain to:
+        // 1. Set the frame rate (fps), with the first frame at the start time so
+        //    frames line up with the audio (and with extract_images_segmented())
+        // 2. Scale the width while maintaining aspect ratio (-1)
+        // 3. Convert to grayscale format
+        snprintf(vf, FILTER_SIZE, "fps=%s:start_time=0,scale=%s:-1,format=gray", FPS, WIDTH);
+    }
+    args[n++] = "-map"; // First video stream only
+    args[n++] = "0:v:0";
+    args[n++] = "-vf";
+    args[n++] = vf;
+    if (VFR)
+    {
+        args[n++] = "-fps_mode"; // Neither duplicate nor drop frames
+        args[n++] = "passthrough";
+    }
+
+    // Output pattern for the extracted frames
+    args[n++] = pattern;
+    return n;
+}
+
+/**
+ * Convert a HH:MM:SS timestamp (already validated) to seconds
+ *
+ * @param str Timestamp string
+ * @return Number of seconds it represents
+ */
+static double timestamp_seconds(const char *str)
+{
+    int h = 0, m = 0, sec = 0;
+    sscanf(str, "%d:%d:%d", &h, &m, &sec);
+    return h * 3600.0 + m * 60.0 + sec;
+}
+
+/**
+ * Rendering settings of the command line as a libsm context
+ *
+ * The converters and live playback render through libsm, like any other
+ * program embedding it would.
+ *
+ * @param ctx Context to fill (release it with sm_release())
+ */
+void render_context(sm_context_t *ctx)
+{
+    sm_init(ctx);
+    ctx->width = atoi(WIDTH);
+    ctx->fps = atoi(FPS);
+    ctx->start = timestamp_seconds(START_TIME);
+    ctx->duration = atoi(DURATION);
+    ascii_parse_dither(DITHER, &ctx->dither);
+    ctx->stabilize = atoi(STABILIZE);
+    ctx->threads = render_threads();
+}
+
+/**
+ * Run ffmpeg and collect the start of its log
+ *
+ * @param args Argument vector (NULL-terminated)
+ * @param buf Output buffer for the log (stderr), always NUL-terminated
+ * @param len Size of the output buffer
+ * @return 0 if ffmpeg ran (whatever its exit status), -1 otherwise
+ */
+static int ffmpeg_log(char **args, char *buf, size_t len)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0)
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        execvp("ffmpeg", args);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    // Keep draining after the buffer is full so ffmpeg never blocks on the pipe
+    size_t used = 0;
+    char scratch[BUFFER_SIZE];
+    ssize_t n;
+    while ((n = read(fds[0], used + 1 < len ? buf + used : scratch,
+                     used + 1 < len ? len - 1 - used : sizeof(scratch))) != 0)
+    {
+        if (n < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (n > 0 && used + 1 < len)
+        {
+            used += (size_t)n;
+        }
+    }
+    buf[used] = '\0';
+    close(fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) != 127 ? 0 : -1;
+}
+
+/**
+ * Probe the length of the input video
+ *
+ * ffmpeg prints the container duration when it opens an input; there is no
+ * need for ffprobe.
+ *
+ * @return Duration in seconds, or -1 if it is unknown
+ */
+static double probe_duration()
+{
+    char *args[] = {"ffmpeg", "-hide_banner", "-nostdin", "-i", VIDEO_PATH, NULL};
+    char log[4 * BUFFER_SIZE];
+    int h, m;
+    double sec;
+    const char *at;
+    if (ffmpeg_log(args, log, sizeof(log)) != 0 || (at = strstr(log, "Duration: ")) == NULL ||
+        sscanf(at, "Duration: %d:%d:%lf", &h, &m, &sec) != 3)
+    {
+        return -1;
+    }
+    return h * 3600.0 + m * 60.0 + sec;
+}
+
+/**
+ * Check whether the interrupted conversion being resumed converted every frame
+ *
+ * A conversion killed after its last frame but before commit_conversion()
+ * leaves a complete journal, and extracting on from past the end of the
+ * input would only run ffmpeg for nothing. A full conversion has one frame per
+ * 1/FPS seconds of the window, the last one shown until the window ends.
+ *
+ * @return 1 if no frame is left to convert, 0 if some are (or it is unknown)
+ */
+static int resume_complete()
+{
+    if (RESUME_FRAMES == 0)
+    {
+        return 0;
+    }
+    double start = timestamp_seconds(START_TIME);
+    double window = probe_duration() - start;
+    if (atoi(DURATION) > 0 && atoi(DURATION) < window)
+    {
+        window = atoi(DURATION);
+    }
+    if (window <= 0)
+    {
+        return 0;
+    }
+    double slots = window * atoi(FPS);
+    long long frames = (long long)slots;
+    if (frames < slots - 1e-6)
+    {
+        frames++; // A partly covered slot still shows a frame
+    }
+    return RESUME_FRAMES >= frames;
+}
+
+/**
+ * Probe whether the input's audio can be stream-copied
+ *
+ * ffmpeg describes the streams of an input when it opens it; the first audio
+ * stream's line reads "Stream #0:1(und): Audio: aac (LC) ...".
+ *
+ * @return Extension of the container to copy the audio into, or NULL if the
+ *         audio has to be encoded to MP3 (or could not be probed)
+ */
+static const char *probe_audio_copy()
+{
+    char *args[] = {"ffmpeg", "-hide_banner", "-nostdin", "-i", VIDEO_PATH, NULL};
+    char log[16 * BUFFER_SIZE];
+    char codec[32];
+    const char *at;
+    if (ffmpeg_log(args, log, sizeof(log)) != 0 || (at = strstr(log, ": Audio: ")) == NULL ||
+        sscanf(at, ": Audio: %31[^ ,\n]", codec) != 1)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < AUDIO_FORMAT_COUNT; i++)
+    {
+        if (strcmp(codec, AUDIO_FORMATS[i].codec) == 0)
+        {
+            return AUDIO_FORMATS[i].ext;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Extract audio track from the input video file (pipeline stage body)
+ *
+ * This function runs inside the child process forked by the stage runner.
+ * Audio in a codec every player takes is stream-copied into a matching
+ * container, which only costs reading the file; anything else, or a copy
+ * that fails, is encoded to MP3 by ffmpeg replacing the stage process. The
+ * extraction respects the START_TIME and DURATION parameters (a copy cuts
+ * at packet boundaries). It does not depend on any other stage.
+ *
+ * Dependencies: ffmpeg must be installed and accessible in the PATH
+ *
+ * @param upstream_fd Unused, audio extraction has no upstream stage
+ * @return Exit status for the stage (only returned after a copy, or if ffmpeg cannot be run)
+ */
+int extract_audio(int upstream_fd)
+{
+    (void)upstream_fd;
+
+    char out[AUDIO_PATH_SIZE];
+    char *args[24]; // Array to hold command and arguments
+    int arg_count;
+
+    const char *ext = probe_audio_copy();
+    if (ext != NULL)
+    {
+        audio_output_path(out, sizeof(out), ext);
+        arg_count = add_input_args(args, 0);
+        arg_count = add_audio_output_args(args, arg_count, out, true);
+        args[arg_count++] = NULL;
+
+        pid_t stage = getpid();
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // Go down with the stage when the stage runner stops it
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != stage)
+            {
+                _exit(EXIT_FAILURE);
+            }
+            execvp("ffmpeg", args);
+            _exit(EXIT_FAILURE);
+        }
+        int status = 0;
+        while (pid > 0 && waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            return EXIT_SUCCESS;
+        }
+        unlink(out); // Fall back to encoding
+    }
+
+    // Encode to MP3
+    audio_output_path(out, sizeof(out), ".mp3");
+    arg_count = add_input_args(args, 0);
+    arg_count = add_audio_output_args(args, arg_count, out, false);
+    args[arg_count++] = NULL; // Terminate the arguments list
+
+    // Execute ffmpeg with the prepared arguments
+    execvp("ffmpeg", args);
+    return EXIT_FAILURE; // Only reached if execvp fails
+}
+
+/**
+ * Probe when the first frame after START_TIME is shown
+ *
+ * @return Its time in seconds after START_TIME, or -1 if there is no such frame
+ */
+static double probe_first_frame()
+{
+    char *args[24];
+    int n = 0;
+    args[n++] = "ffmpeg";
+    args[n++] = "-hide_banner";
+    args[n++] = "-nostdin";
+    args[n++] = "-ss";
+    args[n++] = START_TIME;
+    args[n++] = "-i";
+    args[n++] = VIDEO_PATH;
+    args[n++] = "-map";
+    args[n++] = "0:v:0";
+    args[n++] = "-frames:v";
+    args[n++] = "1";
+    args[n++] = "-vf";
+    args[n++] = "showinfo";
+    args[n++] = "-f";
+    args[n++] = "null";
+    args[n++] = "-";
+    args[n++] = NULL;
+
+    char log[8 * BUFFER_SIZE];
+    double pts;
+    const char *at;
+    if (ffmpeg_log(args, log, sizeof(log)) != 0 || (at = strstr(log, "pts_time:")) == NULL ||
+        sscanf(at, "pts_time:%lf", &pts) != 1 || pts < 0)
+    {
+        return -1;
+    }
+    return pts;
+}
+
+/**
+ * Extract grayscale frames with several ffmpeg processes in parallel
+ *
+ * The serial extractor's output is cut into `segments` contiguous ranges of
+ * frames, extracted concurrently and written straight under their final
+ * numbers. Ranges are given as slots of the grid the fps filter lays over the
+ * input (one slot every 1/FPS seconds from the start of the file), so they
+ * meet exactly: an extractor seeks to the keyframe before its first slot,
+ * decodes from there keeping the input's own timestamps, and trims the fps
+ * filter's output to its slots. The frame the filter shows in a slot is the
+ * last input frame that starts before it, which decoding from the keyframe
+ * before the slot always includes, so each range is frame for frame what the
+ * serial extractor writes there. The first range is the serial command with
+ * an end, and the window's end (-d) is applied the way ffmpeg's -t does it,
+ * relative to the first frame after the start time.
+ *
+ * Frames are written atomically, so the streaming converter can take any
+ * frame that exists whatever order the extractors finish in. If the ranges
+ * do not join up in the end, the frames are removed for a serial rerun.
+ *
+ * A resumed conversion (RESUME_FRAMES) extracts only the frames after the
+ * ones it keeps, the same way: as ranges starting at the next slot, with a
+ * single range for a short remainder.
+ *
+ * Dependencies: ffmpeg must be installed and accessible in the PATH
+ *
+ * @param segments Number of extractors to run
+ * @return Exit status for the stage, or -1 to extract serially instead
+ */
+int extract_images_segmented(int segments)
+{
+    int fps = atoi(FPS);
+    double start = timestamp_seconds(START_TIME);
+    double window = atoi(DURATION);
+    double length = probe_duration();
+    if (length > start && (window <= 0 || window > length - start))
+    {
+        window = length - start;
+    }
+
+    // Short segments would spend more time seeking than decoding
+    const double min_segment = 10.0;
+    double left = window - (double)RESUME_FRAMES / fps;
+    if (left / min_segment < segments)
+    {
+        segments = (int)(left / min_segment);
+    }
+    if (RESUME_FRAMES > 0 && segments < 1)
+    {
+        segments = 1;
+    }
+    if (length <= start || segments < 1 || (segments < 2 && RESUME_FRAMES == 0))
+    {
+        return -1;
+    }
+    double first = 0;
+    if (atoi(DURATION) > 0 && (first = probe_first_frame()) < 0)
+    {
+        return -1;
+    }
+
+    // Output frame i is slot base + i of the grid
+    long long base = (long long)start * fps;
+    long long frames = (long long)(window * fps) + 1;
+    long long per = (frames - RESUME_FRAMES + segments - 1) / segments;
+    if (per < 1)
+    {
+        per = 1; // The estimate may fall short by a frame
+    }
+
+    char pattern[sizeof(WORK_DIR) + PATH_MAX + sizeof("_gray_%%04d.pgm")];
+    snprintf(pattern, sizeof(pattern), "%s/%s_gray_%%04d.pgm", WORK_DIR, VIDEO_NAME);
+
+    pid_t *pids = calloc(segments, sizeof(*pids));
+    if (pids == NULL)
+    {
+        return -1;
+    }
+    pid_t stage = getpid();
+    int launched = 0;
+    for (; launched < segments; launched++)
+    {
+        long long first_frame = RESUME_FRAMES + launched * per; // 0-based output frame numbers
+        int last = launched == segments - 1;
+
+        char vf[BUFFER_SIZE], seek[64], start_number[32];
+        char *args[40];
+        int n;
+        if (first_frame == 0)
+        {
+            // The serial command, ending after this range
+            n = add_input_args(args, 0);
+            snprintf(vf, sizeof(vf), "fps=%s:start_time=0,trim=end_pts=%lld,scale=%s:-1,format=gray",
+                     FPS, per, WIDTH);
+        }
+        else
+        {
+            // From the keyframe before the slot ahead of the range, on the
+            // input's own timeline, dropping frames outside the window
+            long long slot = base + first_frame;
+            snprintf(seek, sizeof(seek), "%.6f", (double)(slot - 1) / fps);
+            int len = snprintf(vf, sizeof(vf), "trim=start=%.6f", start);
+            if (atoi(DURATION) > 0)
+            {
+                len += snprintf(vf + len, sizeof(vf) - len, ":end=%.6f", start + first + atoi(DURATION));
+            }
+            len += snprintf(vf + len, sizeof(vf) - len, ",fps=%s,trim=start_pts=%lld", FPS, slot);
+            if (!last)
+            {
+                len += snprintf(vf + len, sizeof(vf) - len, ":end_pts=%lld", slot + per);
+            }
+            snprintf(vf + len, sizeof(vf) - len, ",scale=%s:-1,format=gray", WIDTH);
+
+            n = 0;
+            args[n++] = "ffmpeg";
+            args[n++] = "-loglevel";
+            args[n++] = "quiet";
+            args[n++] = "-nostdin";
+            args[n++] = "-noaccurate_seek";
+            args[n++] = "-copyts";
+            args[n++] = "-start_at_zero";
+            args[n++] = "-ss";
+            args[n++] = seek;
+            args[n++] = "-i";
+            args[n++] = VIDEO_PATH;
+        }
+        snprintf(start_number, sizeof(start_number), "%lld", first_frame + 1);
+        args[n++] = "-map";
+        args[n++] = "0:v:0";
+        args[n++] = "-vf";
+        args[n++] = vf;
+        args[n++] = "-start_number";
+        args[n++] = start_number;
+        args[n++] = "-atomic_writing";
+        args[n++] = "1";
+        args[n++] = pattern;
+        args[n++] = NULL;
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            break;
+        }
+        if (pid == 0)
+        {
+            // Go down with the stage when the stage runner stops it
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != stage)
+            {
+                _exit(EXIT_FAILURE);
+            }
+            execvp("ffmpeg", args);
+            _exit(EXIT_FAILURE);
+        }
+        pids[launched] = pid;
+    }
+
+    int failed = launched < segments;
+    for (int i = 0; i < launched; i++)
+    {
+        int status;
+        while (waitpid(pids[i], &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            failed = 1;
+        }
+    }
+    free(pids);
+
+    // Every range but the last must be full, unless the video ended in it
+    // and nothing came after
+    char path[PATH_MAX];
+    int ended = 0;
+    for (int i = 0; i < segments && !failed; i++)
+    {
+        frame_path(path, sizeof(path), WORK_DIR, (int)(RESUME_FRAMES + i * per) + 1, ".pgm");
+        int has_first = access(path, F_OK) == 0;
+        frame_path(path, sizeof(path), WORK_DIR, (int)(RESUME_FRAMES + (i + 1) * per), ".pgm");
+        int full = access(path, F_OK) == 0;
+        if ((ended && has_first) || (i == 0 && !has_first && RESUME_FRAMES == 0))
+        {
+            failed = 1;
+        }
+        ended = ended || (i < segments - 1 && !full);
+    }
+
+    if (failed)
+    {
+        char glob_pattern[PATH_MAX + sizeof("_gray_*.pgm*")];
+        snprintf(glob_pattern, sizeof(glob_pattern), "%s_gray_*.pgm*", VIDEO_NAME);
+        remove_matching(WORK_DIR, glob_pattern);
+        return -1;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Extract grayscale frames from the input video file (pipeline stage body)
+ *
+ * This function runs inside the child process forked by the stage runner and
+ * replaces it with ffmpeg, which extracts frames from the video file at the
+ * specified FPS rate, converting them to grayscale and resizing them based on
+ * the configured width. Each frame is saved as a separate binary PGM file in the
+ * conversion's working directory (WORK_DIR), which the in-process converter can
+ * read without an image library. The frame extraction respects the START_TIME and DURATION parameters.
+ *
+ * Dependencies: ffmpeg must be installed and accessible in the PATH
+ *
+ * @param upstream_fd Unused, frame extraction has no upstream stage
+ * @return Exit status for the stage (only returned if ffmpeg cannot be run)
+ */
+int extract_images_grayscale(int upstream_fd)
+{
+    (void)upstream_fd;
+
+    // Long videos can be split over several extractors; fall through to the
+    // single ffmpeg below when the split is not worth it or did not work out
+    // (segments are cut on the fps grid, which VFR mode does without)
+    int segments = atoi(SEGMENTS);
+    if (resume_complete())
+    {
+        return EXIT_SUCCESS; // Nothing left to extract
+    }
+    if ((segments > 1 || RESUME_FRAMES > 0) && !VFR)
+    {
+        int rc = extract_images_segmented(segments);
+        if (rc != -1)
+        {
+            return rc;
+        }
+    }
+
+    // Construct output pattern for the extracted frames
+    // %04d will be replaced by ffmpeg with a 4-digit frame number (0001, 0002, etc.)
+    char output_pattern[sizeof(WORK_DIR) + PATH_MAX + sizeof("_gray_%%04d.pgm")];
+    snprintf(output_pattern, sizeof(output_pattern),
+             "%s/%s_gray_%%04d.pgm", WORK_DIR, VIDEO_NAME);
+
+    // Prepare ffmpeg command arguments
+    char *args[24]; // Array to hold command and arguments
+    char vf[FILTER_SIZE];
+    int arg_count = add_input_args(args, 0);
+    arg_count = add_frames_output_args(args, arg_count, vf, output_pattern);
+    args[arg_count++] = NULL; // Terminate the arguments list
+
+    // Execute ffmpeg with the prepared arguments
+    execvp("ffmpeg", args);
+    return EXIT_FAILURE; // Only reached if execvp fails
+}
+
+/**
+ * Extract audio and grayscale frames with a single ffmpeg pass (pipeline stage body)
+ *
+ * Used in --single-pass mode. One ffmpeg invocation demuxes and decodes the
+ * input once and writes two outputs: the MP3 audio track and the numbered PGM
+ * frames. This halves decoding work for high-bitrate sources at the cost of
+ * audio no longer finishing independently of the video path.
+ *
+ * The audio is always encoded here, never stream-copied: a copy that fails
+ * could only be retried by decoding the frames all over again, which is what
+ * this mode exists to avoid (extract_audio() falls back to encoding instead).
+ *
+ * Dependencies: ffmpeg must be installed and accessible in the PATH
+ *
+ * @param upstream_fd Unused, extraction has no upstream stage
+ * @return Exit status for the stage (only returned if ffmpeg cannot be run)
+ */
+int extract_audio_and_images(int upstream_fd)
+{
+    (void)upstream_fd;
+
+    // Construct both output paths
+    char out[AUDIO_PATH_SIZE];
+    audio_output_path(out, sizeof(out), ".mp3");
+    char output_pattern[sizeof(WORK_DIR) + PATH_MAX + sizeof("_gray_%%04d.pgm")];
+    snprintf(output_pattern, sizeof(output_pattern),
+             "%s/%s_gray_%%04d.pgm", WORK_DIR, VIDEO_NAME);
+
+    // One input, two outputs
+    char *args[32]; // Array to hold command and arguments
+    char vf[FILTER_SIZE];
+    int arg_count = add_input_args(args, 0);
+    arg_count = add_audio_output_args(args, arg_count, out, false);
+    arg_count = add_frames_output_args(args, arg_count, vf, output_pattern);
+    args[arg_count++] = NULL; // Terminate the arguments list
+
+    // Execute ffmpeg with the prepared arguments
+    execvp("ffmpeg", args);
+    return EXIT_FAILURE; // Only reached if execvp fails
+}
+
+/**
+ * Build the path of a numbered frame of a video
+ *
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @param dir Directory holding the frames (WORK_DIR or ASCII_DIR)
+ * @param name Video name
+ * @param index 1-based frame number, as produced by ffmpeg's %04d pattern
+ * @param ext File extension including the dot (".pgm" or ".txt")
+ *
+ * Exits if the path does not fit: a truncated name could be another frame's.
+ */
+void video_frame_path(char *buf, size_t len, const char *dir, const char *name, int index, const char *ext)
+{
+    int n = snprintf(buf, len, "%s/%s_gray_%04d%s", dir, name, index, ext);
+    if (n < 0 || (size_t)n >= len)
+    {
+        fatal_error("Frame path too long for video %s", name);
+    }
+}
+
+/**
+ * Build the path of a numbered frame of the current video (see video_frame_path())
+ */
+void frame_path(char *buf, size_t len, const char *dir, int index, const char *ext)
+{
+    video_frame_path(buf, len, dir, VIDEO_NAME, index, ext);
+}
+
+/**
+ * Count the consecutive numbered frames of a video present in a directory
+ *
+ * Probing resumes from the previous count, so calling this repeatedly while a
+ * stage is producing frames only costs a couple of access() calls each time.
+ *
+ * @param dir Directory holding the frames
+ * @param name Video name
+ * @param ext File extension including the dot
+ * @param cursor In/out count of frames already known to exist
+ * @return Number of consecutive frames found starting at frame 1
+ */
+static int count_frames(const char *dir, const char *name, const char *ext, int *cursor)
+{
+    char path[PATH_MAX];
+    for (;;)
+    {
+        video_frame_path(path, sizeof(path), dir, name, *cursor + 1, ext);
+        if (access(path, F_OK) != 0)
+            break;
+        (*cursor)++;
+    }
+    return *cursor;
+}
+
+/* Progress notes for the combined progress line */
+void frames_progress(char *buf, size_t len)
+{
+    static int extracted = 0;
+    if (extracted < RESUME_FRAMES)
+    {
+        extracted = RESUME_FRAMES; // Numbering carries on after the frames kept
+    }
+    snprintf(buf, len, "%d", count_frames(WORK_DIR, VIDEO_NAME, ".pgm", &extracted));
+}
+
+void ascii_progress(char *buf, size_t len)
+{
+    // Duplicate frames get no file of their own, so follow the frame index
+    char path[PATH_MAX];
+    journal_path(path, sizeof(path), VIDEO_NAME);
+    snprintf(buf, len, "%d", frame_index_written(path));
+}
+
+/**
+ * Build the path of a video's frame index (see frameindex.h)
+ *
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @param name Video name
+ */
+void index_path(char *buf, size_t len, const char *name)
+{
+    snprintf(buf, len, "%s/%s.idx", ASCII_DIR, name);
+}
+
+/**
+ * Build the path of the frame index a conversion of a video is writing
+ *
+ * The index is renamed to index_path() once the conversion is complete
+ * (see commit_conversion()); until then it is the conversion's journal: it
+ * records every frame converted so far, in order, and what a resumed
+ * conversion picks up from.
+ *
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @param name Video name
+ */
+void journal_path(char *buf, size_t len, const char *name)
+{
+    int n = snprintf(buf, len, "%s/%s.journal", ASCII_DIR, name);
+    if (n < 0 || (size_t)n >= len)
+    {
+        fatal_error("Journal path too long for video %s", name);
+    }
+}
+
+/**
+ * Build the path of the settings a video's journal was written with
  *
- * This function examines a directory to determine if it contains any files
- * that match the specified pattern. The pattern can include wildcards
- * and is processed using fnmatch.
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @param name Video name
+ */
+static void job_path(char *buf, size_t len, const char *name)
+{
+    int n = snprintf(buf, len, "%s/%s.job", ASCII_DIR, name);
+    if (n < 0 || (size_t)n >= len)
+    {
+        fatal_error("Job path too long for video %s", name);
+    }
+}
+
+/**
+ * Describe the current conversion: the input as it is now and every setting
+ * that shapes its frames
  *
- * @param dir_path Path to the directory to check
- * @param file_name File name pattern to match (can include wildcards)
- * @return true if a matching file exists, false otherwise
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @return 0 on success, -1 if the input cannot be found or the buffer is too small
  */
-int dir_contains(const char *dir_path, const char *file_name)
+static int conversion_job(char *buf, size_t len)
 {
-    // Validate input parameters
-    if (dir_path == NULL || file_name == NULL)
+    char path[PATH_MAX];
+    struct stat st;
+    if (realpath(VIDEO_PATH, path) == NULL || stat(path, &st) != 0)
     {
-        return false;
+        return -1;
     }
+    int n = snprintf(buf, len,
+                     "path=%s\tsize=%lld\tmtime=%lld.%09ld\tfps=%s\twidth=%s\tstart=%s\tduration=%s\t"
+                     "dither=%s\tstabilize=%s\n",
+                     path, (long long)st.st_size, (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+                     FPS, WIDTH, START_TIME, DURATION, DITHER, STABILIZE);
+    return n < 0 || (size_t)n >= len ? -1 : 0;
+}
 
-    // Open the directory
-    DIR *dir = opendir(dir_path);
-    if (dir == NULL)
+/**
+ * Record the settings a new conversion of the current video runs with
+ *
+ * Written next to the journal, for resume_point() to compare a rerun
+ * against. Nothing is recorded for VFR and single-pass conversions, which
+ * always start over.
+ */
+void record_job()
+{
+    char job[BUFFER_SIZE + PATH_MAX], path[PATH_MAX];
+    if (VFR || SINGLE_PASS || conversion_job(job, sizeof(job)) != 0)
     {
-        return false; // Directory doesn't exist or can't be accessed
+        return;
+    }
+    job_path(path, sizeof(path), VIDEO_NAME);
+    FILE *f = fopen(path, "w");
+    if (f == NULL || fputs(job, f) == EOF || fclose(f) != 0)
+    {
+        user_warning("Cannot record the conversion settings in %s; it cannot be resumed", path);
     }
+}
 
-    // Iterate through directory entries
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL)
+/**
+ * Read a stored ASCII frame of the current video
+ *
+ * @param frame 1-based frame number
+ * @param len Output: length of the frame's text
+ * @return The text (to be freed), or NULL if it cannot be read
+ */
+static char *load_stored_frame(int frame, size_t *len)
+{
+    char path[PATH_MAX];
+    frame_path(path, sizeof(path), ASCII_DIR, frame, ".txt");
+
+    char *text = NULL;
+    struct stat st;
+    FILE *f = fopen(path, "rb");
+    if (f != NULL && fstat(fileno(f), &st) == 0 && (text = malloc(st.st_size + 1)) != NULL)
     {
-        // Check if the current entry matches the pattern
-        // fnmatch allows for wildcards and pattern matching
-        if (fnmatch(file_name, entry->d_name, 0) == 0)
+        *len = fread(text, 1, st.st_size, f);
+        if (*len != (size_t)st.st_size)
         {
-            closedir(dir);
-            return true; // Found a matching file
+            free(text);
+            text = NULL;
+        }
+    }
+    if (f != NULL)
+    {
+        fclose(f);
+    }
+    return text;
+}
+
+/**
+ * Check that a frame the journal records as stored is on disk in full
+ * (frame_index_check_fn)
+ */
+static int intact_frame(int frame, uint64_t hash, void *opaque)
+{
+    (void)opaque;
+    size_t len;
+    char *text = load_stored_frame(frame, &len);
+    int intact = text != NULL && frame_hash(text, len) == hash;
+    free(text);
+    return intact;
+}
+
+/**
+ * Find how much of an interrupted conversion of the current video can be kept
+ *
+ * An interrupted conversion leaves its journal (see journal_path()) and the
+ * frame files it completed. If it ran with the same settings on the same
+ * input, its journal is replayed up to the first frame whose file is missing
+ * or does not hash to what the journal recorded; the journal is cut there and
+ * the conversion continues with the next frame.
+ *
+ * @return Number of frames kept, 0 to start over
+ */
+int resume_point()
+{
+    char job[BUFFER_SIZE + PATH_MAX], recorded[sizeof(job)], path[PATH_MAX];
+    if (VFR || SINGLE_PASS || conversion_job(job, sizeof(job)) != 0)
+    {
+        return 0;
+    }
+    job_path(path, sizeof(path), VIDEO_NAME);
+    FILE *f = fopen(path, "r");
+    size_t n = f != NULL ? fread(recorded, 1, sizeof(recorded) - 1, f) : 0;
+    if (f != NULL)
+    {
+        fclose(f);
+    }
+    recorded[n] = '\0';
+    if (strcmp(job, recorded) != 0)
+    {
+        return 0;
+    }
+
+    journal_path(path, sizeof(path), VIDEO_NAME);
+    frame_index_writer_t *journal = frame_index_resume(path, intact_frame, NULL);
+    int kept = frame_index_count(journal);
+    return journal != NULL && frame_index_close(journal) == 0 ? kept : 0;
+}
+
+/**
+ * Publish the finished conversion of the current video
+ *
+ * The journal becomes the frame index, and then the audio moves out of the
+ * working directory into AUDIO_DIR, which is what marks the video as
+ * converted (see video_extracted()). Each is a rename, so a video is either
+ * fully there or not at all. The working directory is removed.
+ */
+void commit_conversion()
+{
+    char from[AUDIO_PATH_SIZE], to[AUDIO_PATH_SIZE];
+    journal_path(from, sizeof(from), VIDEO_NAME);
+    index_path(to, sizeof(to), VIDEO_NAME);
+    if (rename(from, to) != 0)
+    {
+        fatal_error("Failed to move the frame index into place: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < AUDIO_FORMAT_COUNT; i++)
+    {
+        snprintf(from, sizeof(from), "%s/%s%s", WORK_DIR, VIDEO_NAME, AUDIO_FORMATS[i].ext);
+        snprintf(to, sizeof(to), AUDIO_DIR "/%s%s", VIDEO_NAME, AUDIO_FORMATS[i].ext);
+        if (rename(from, to) == 0)
+        {
+            break;
+        }
+        if (errno != ENOENT)
+        {
+            fatal_error("Failed to move the audio into place: %s", strerror(errno));
+        }
+    }
+    job_path(from, sizeof(from), VIDEO_NAME);
+    unlink(from);
+    close_work_dir();
+}
+
+/**
+ * Build the path of a video's frame timestamp log (written in VFR mode)
+ *
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @param name Video name
+ */
+void pts_log_path(char *buf, size_t len, const char *name)
+{
+    int n = snprintf(buf, len, "%s/%s.pts", WORK_DIR, name);
+    if (n < 0 || (size_t)n >= len)
+    {
+        fatal_error("Timestamp log path too long for video %s", name);
+    }
+}
+
+/**
+ * Load the frame index of a video
+ *
+ * Videos converted before frames were deduplicated have no index; every
+ * numbered ASCII frame then stands for itself.
+ *
+ * @param name Video name
+ * @param idx Index to fill in
+ * @return 0 on success, -1 if the video has no frames
+ */
+int load_frame_index(const char *name, frame_index_t *idx)
+{
+    char path[PATH_MAX];
+    index_path(path, sizeof(path), name);
+    if (frame_index_load(path, idx) == 0)
+    {
+        return 0;
+    }
+    int count = 0;
+    return frame_index_identity(idx, count_frames(ASCII_DIR, name, ".txt", &count));
+}
+
+/* Frames rendered ahead of their writes completing (when writes go through io_uring) */
+#define STORE_BUFFERS 16
+
+/* Output side of the converters: rendering settings, the frame index and text buffers */
+struct frame_store
+{
+    sm_context_t render;         /* Rendering settings, and the previous frame's glyphs with STABILIZE */
+    frame_index_writer_t *index;
+    batch_io_t *io;              /* Batched writes, NULL for plain blocking writes */
+    char *text[STORE_BUFFERS];   /* Buffer i is owned by write request i while in flight */
+    size_t size[STORE_BUFFERS];
+    int pending[STORE_BUFFERS];  /* Frame written from buffer i, until its file is in place */
+    int next;                    /* Buffer for the next frame */
+    int queued;                  /* Writes queued but not yet submitted */
+};
+
+/**
+ * Check whether a stored ASCII frame has exactly the given contents
+ *
+ * Confirms a hash match before a frame is deduplicated against it.
+ */
+static int same_as_stored(int frame, const char *text, size_t len)
+{
+    size_t stored_len;
+    char *stored = load_stored_frame(frame, &stored_len);
+    int same = stored != NULL && stored_len == len && memcmp(stored, text, len) == 0;
+    free(stored);
+    return same;
+}
+
+/**
+ * Move a completed frame file into place
+ *
+ * Frames are written under a temporary name and renamed, so that a frame
+ * file is never seen partly written, even after the conversion was killed.
+ *
+ * @param frame 1-based frame number
+ * @return 0 on success, -1 on error
+ */
+static int commit_frame_file(int frame)
+{
+    char tmp[PATH_MAX], path[PATH_MAX];
+    frame_path(tmp, sizeof(tmp), ASCII_DIR, frame, ".tmp");
+    frame_path(path, sizeof(path), ASCII_DIR, frame, ".txt");
+    return rename(tmp, path);
+}
+
+/**
+ * Wait for the write from a frame store buffer, and move its frame file into place
+ *
+ * @param store Frame store of the running conversion
+ * @param b Buffer
+ * @return 0 on success (or if nothing was written from the buffer), -1 on error
+ */
+static int frame_store_settle(struct frame_store *store, int b)
+{
+    ssize_t done = batch_io_wait(store->io, b);
+    if (done < 0 && done != -ENOENT)
+    {
+        return -1;
+    }
+    int frame = store->pending[b];
+    store->pending[b] = 0;
+    return frame != 0 && commit_frame_file(frame) != 0 ? -1 : 0;
+}
+
+/**
+ * Settle every frame store buffer (see frame_store_settle())
+ *
+ * @param store Frame store of the running conversion
+ * @return 0 if every frame file is in place, -1 otherwise
+ */
+static int frame_store_drain(struct frame_store *store)
+{
+    int failed = 0;
+    for (int b = 0; b < STORE_BUFFERS; b++)
+    {
+        if (frame_store_settle(store, b) != 0)
+        {
+            failed = 1;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+/**
+ * Open the frame store for a conversion of the current video
+ *
+ * A resumed conversion continues the journal after the frames it keeps, and
+ * stabilization carries on from the last of them.
+ *
+ * @param store Store to initialize
+ * @return 0 on success, -1 if the journal cannot be created or continued
+ */
+static int frame_store_open(struct frame_store *store)
+{
+    char path[PATH_MAX];
+    journal_path(path, sizeof(path), VIDEO_NAME);
+
+    *store = (struct frame_store){0};
+    render_context(&store->render);
+    if (RESUME_FRAMES == 0)
+    {
+        store->index = frame_index_create(path);
+    }
+    else if ((store->index = frame_index_resume(path, NULL, NULL)) != NULL)
+    {
+        frame_index_t idx = {0};
+        size_t len = 0;
+        char *last = NULL;
+        if (frame_index_count(store->index) != RESUME_FRAMES || frame_index_load(path, &idx) != 0 ||
+            (last = load_stored_frame(idx.stored[RESUME_FRAMES - 1], &len)) == NULL ||
+            sm_resume(&store->render, last, len) != SM_OK)
+        {
+            frame_index_close(store->index);
+            store->index = NULL;
+        }
+        frame_index_free(&idx);
+        free(last);
+    }
+    store->io = batch_io_create(STORE_BUFFERS);
+    return store->index ? 0 : -1;
+}
+
+/**
+ * Finish a conversion's frame store
+ *
+ * @param store Store to close
+ * @return 0 if the frame index was written completely, -1 otherwise
+ */
+static int frame_store_close(struct frame_store *store)
+{
+    // Every frame file must be complete before the index is
+    int failed = frame_store_drain(store) != 0;
+    batch_io_destroy(store->io);
+    for (int i = 0; i < STORE_BUFFERS; i++)
+    {
+        free(store->text[i]);
+    }
+    sm_release(&store->render);
+    if (frame_index_close(store->index) != 0)
+    {
+        failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+/**
+ * Write a rendered frame to its numbered file
+ *
+ * With io_uring the write (open, write, close) is queued and submitted in
+ * batches of half the buffers, and the buffer stays with the kernel until it
+ * completes; otherwise the file is written directly.
+ *
+ * @param store Frame store of the running conversion
+ * @param frame 1-based frame number
+ * @param len Length of the text in the current buffer
+ * @return 0 on success, -1 on error
+ */
+static int write_stored_frame(struct frame_store *store, int frame, size_t len)
+{
+    char path[PATH_MAX];
+    frame_path(path, sizeof(path), ASCII_DIR, frame, ".tmp");
+    const char *text = store->text[store->next];
+
+    if (store->io == NULL)
+    {
+        FILE *f = fopen(path, "wb");
+        int ok = f && fwrite(text, 1, len, f) == len;
+        return (f && fclose(f) != 0) || !ok ? -1 : commit_frame_file(frame);
+    }
+
+    if (batch_io_queue_write(store->io, store->next, path, text, len) != 0)
+    {
+        return -1;
+    }
+    store->pending[store->next] = frame;
+    store->next = (store->next + 1) % STORE_BUFFERS;
+    if (++store->queued >= STORE_BUFFERS / 2)
+    {
+        store->queued = 0;
+        return batch_io_submit(store->io);
+    }
+    return 0;
+}
+
+/**
+ * Render a frame and add it to the content-addressed frame store
+ *
+ * The rendered text is hashed; if an earlier frame has the same content the
+ * frame index simply refers to it, otherwise the text is written to the
+ * frame's own numbered file.
+ *
+ * @param img Grayscale frame
+ * @param frame 1-based frame number
+ * @param pts Time the frame is shown at, in seconds from the start of the video
+ * @param store Frame store of the running conversion
+ * @return 0 on success, -1 on error
+ */
+static int store_ascii_frame(const gray_image_t *img, int frame, double pts, struct frame_store *store)
+{
+    // Take the next buffer back from its earlier write, if it had one
+    int b = store->next;
+    if (frame_store_settle(store, b) != 0)
+    {
+        return -1;
+    }
+
+    // Render into it, fusing dithering into the luma-to-glyph loop
+    size_t len;
+    int rc = sm_render(&store->render, img, store->text[b], store->size[b], &len);
+    if (rc == SM_ERR_BUFFER)
+    {
+        free(store->text[b]);
+        store->text[b] = malloc(len);
+        store->size[b] = store->text[b] ? len : 0;
+        rc = store->text[b] ? sm_render(&store->render, img, store->text[b], len, &len) : SM_ERR_NOMEM;
+    }
+    if (rc != SM_OK)
+    {
+        return -1;
+    }
+
+    // Refer to an earlier frame with the same content, or store this one
+    uint64_t hash = frame_hash(store->text[b], len);
+    int stored = frame_index_lookup(store->index, hash);
+    if (stored != 0 && frame_store_drain(store) != 0)
+    {
+        return -1; // The candidate may still be on its way to disk
+    }
+    if (stored == 0 || !same_as_stored(stored, store->text[b], len))
+    {
+        if (write_stored_frame(store, frame, len) != 0)
+        {
+            return -1;
+        }
+        stored = frame;
+    }
+    return frame_index_append(store->index, stored, hash, pts);
+}
+
+/**
+ * Read the next frame's timestamp from the timestamp log (VFR mode)
+ *
+ * Each frame has a "frame:N pts:P pts_time:T" line in the log, followed by
+ * its metadata lines.
+ *
+ * @param log Log open for reading, positioned after the previous frame's line
+ * @param pts Output: seconds from the start time, or -1 if the frame has none
+ * @return 0 on success, -1 if the next frame's line is not (fully) written yet
+ */
+static int read_logged_pts(FILE *log, double *pts)
+{
+    char line[BUFFER_SIZE];
+    while (fgets(line, sizeof(line), log) != NULL)
+    {
+        if (strchr(line, '\n') == NULL)
+        {
+            fseek(log, -(long)strlen(line), SEEK_CUR); // Partly written, read it again later
+            break;
+        }
+        const char *at = strstr(line, "pts_time:");
+        if (strncmp(line, "frame:", 6) == 0 && at != NULL)
+        {
+            if (sscanf(at, "pts_time:%lf", pts) != 1)
+            {
+                *pts = -1; // NOPTS
+            }
+            return 0;
+        }
+    }
+    clearerr(log);
+    return -1;
+}
+
+/**
+ * Convert the current video's frames to ASCII art (pipeline stage body)
+ *
+ * This function converts the numbered PGM frames of the current video to ASCII
+ * art text files with the in-process converter (see ascii.c). Luma is quantized
+ * onto the glyph ramp using the configured DITHER mode, and the rows of each
+ * frame are split across one thread per online CPU.
+ *
+ * The stage streams from frame extraction: ffmpeg writes frames in order, so
+ * frame N is complete as soon as frame N+1 appears, and every frame is complete
+ * once upstream_fd reports EOF. Conversion therefore keeps pace with extraction
+ * instead of waiting for it to finish.
+ *
+ * Frames whose text is identical to an earlier frame are not written again;
+ * the video's frame index refers them to the stored copy instead.
+ *
+ * Frame N is shown (N - 1) / FPS seconds into the video, or in VFR mode at
+ * the timestamp extraction logged for it (see add_frames_output_args()).
+ *
+ * @param upstream_fd Pipe that reaches EOF when extraction has finished, or -1
+ *                    if extraction already finished
+ * @return EXIT_SUCCESS if every frame was converted, EXIT_FAILURE otherwise
+ */
+int batch_convert_to_ascii(int upstream_fd)
+{
+    // Resolve conversion parameters and start the frame index once for the whole batch
+    struct frame_store store;
+    if (frame_store_open(&store) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int upstream_done = upstream_fd == -1;
+    int index = RESUME_FRAMES + 1;
+    int fps = atoi(FPS);
+    FILE *log = NULL; // Timestamp log, opened with the first frame in VFR mode
+    double pts = 0;
+    int failed = 0;
+
+    while (1)
+    {
+        // Paths for the current frame and its successor
+        char input_path[PATH_MAX];
+        char next_path[PATH_MAX];
+        frame_path(input_path, sizeof(input_path), WORK_DIR, index, ".pgm");
+        frame_path(next_path, sizeof(next_path), WORK_DIR, index + 1, ".pgm");
+
+        int have_frame = access(input_path, F_OK) == 0;
+        if (have_frame && (upstream_done || access(next_path, F_OK) == 0))
+        {
+            // Time the frame is shown at; a frame without a timestamp stays with the previous one
+            if (VFR)
+            {
+                char log_path[PATH_MAX];
+                pts_log_path(log_path, sizeof(log_path), VIDEO_NAME);
+                double logged;
+                if ((log == NULL && (log = fopen(log_path, "r")) == NULL) ||
+                    read_logged_pts(log, &logged) != 0)
+                {
+                    failed = 1; // The log always has an entry for a frame that exists
+                    break;
+                }
+                pts = logged >= 0 ? logged : pts;
+            }
+            else
+            {
+                pts = (double)(index - 1) / fps;
+            }
+
+            // Convert this frame into the frame store
+            gray_image_t img;
+            if (gray_image_load_pgm(input_path, &img) != 0)
+            {
+                failed = 1;
+                break;
+            }
+            int rc = store_ascii_frame(&img, index, pts, &store);
+            gray_image_free(&img);
+            if (rc != 0)
+            {
+                failed = 1;
+                break;
+            }
+            index++;
+            continue;
+        }
+
+        // Every frame has been produced and converted
+        if (upstream_done)
+        {
+            break;
+        }
+
+        // Wait for the next frame to land or for extraction to finish
+        struct pollfd pfd = {.fd = upstream_fd, .events = POLLIN};
+        if (poll(&pfd, 1, 50) > 0)
+        {
+            upstream_done = 1; // Only EOF is ever delivered on this pipe
         }
     }
 
-    // Clean up and return false if no match was found
-    closedir(dir);
-    return false;
+    if (log != NULL)
+    {
+        fclose(log);
+    }
+
+    // No frames at all means extraction produced nothing usable
+    if (frame_store_close(&store) != 0 || failed)
+    {
+        return EXIT_FAILURE;
+    }
+    return index > 1 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+
 /**
- * Play the ASCII video with synchronized audio
+ * Write a deterministic synthetic grayscale frame for the benchmark
  *
- * This function plays the ASCII video for the current VIDEO_NAME by:
- * 1. Checking if the video has been properly extracted
- * 2. Creating two child processes - one for displaying frames and one for playing audio
- * 3. Synchronizing these processes to create a complete playback experience
+ * A moving interference pattern, frozen for every fourth stretch of ten
+ * frames so that the deduplication path is exercised as well.
  *
- * If the video hasn't been extracted (except for the default video),
- * the function will exit with an error message.
+ * @param path Output PGM path
+ * @param t Frame number (0-based)
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param row Scratch row of width bytes
+ * @return 0 on success, -1 on write error
  */
-void play()
+static int write_bench_frame(const char *path, int t, int width, int height, uint8_t *row)
 {
-    // Verify the video exists and has been properly extracted
-    // Skip this check for the default video which may be pre-installed
-    if (is_directory_empty(ASCII_DIR))
+    if ((t / 10) % 4 == 3)
     {
-        user_fatal("No ASCII art frames found. Please extract video using -i <video_path> first.");
+        t = (t / 10) * 10 - 1; // Hold the last moving frame
     }
-    if (!video_extracted() && strcmp(VIDEO_NAME, DEFAULT_VIDEO_NAME) != 0)
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
     {
-        user_fatal("%s doesn't exist, try inserting a new one with -i <video_path>", VIDEO_NAME);
+        return -1;
     }
-
-    // Create first child process for displaying ASCII frames
-    pid_t pid = fork();
-    if (pid == -1)
+    fprintf(f, "P5\n%d %d\n255\n", width, height);
+    for (int y = 0; y < height; y++)
     {
-        fatal_error("Fork failed: %s", strerror(errno));
+        for (int x = 0; x < width; x++)
+        {
+            row[x] = (uint8_t)((x * 3 + y * 2 + t * 4) ^ ((x * y + t * 64) >> 7));
+        }
+        fwrite(row, 1, width, f);
     }
-    if (pid == 0)
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/**
+ * Count how many cells change glyph from one frame to the next
+ *
+ * @return Average over the frames after the first of the current video, or
+ *         -1 if its frames cannot be read
+ */
+static double changed_cells_per_frame()
+{
+    frame_index_t idx;
+    frame_cache_t *cache;
+    if (load_frame_index(VIDEO_NAME, &idx) != 0)
     {
-        // Child process: display the ASCII frames
-        draw_frames();
+        return -1;
     }
-    else
+    if ((cache = frame_cache_create(0, 0, ascii_frame_path, &idx)) == NULL)
     {
-        // Parent process: create second child for audio playback
+        frame_index_free(&idx);
+        return -1;
+    }
 
-        // Create second child process for playing audio
-        pid_t pid2 = fork();
-        if (pid2 == -1)
-        {
-            fatal_error("Fork failed: %s", strerror(errno));
-        }
-        if (pid2 == 0)
+    // Frames of a run are identical, so only run boundaries can change cells
+    char *prev = NULL;
+    size_t prev_len = 0;
+    uint64_t changed = 0;
+    int ok = 1;
+    for (int run = 1; run <= idx.runs && ok; run++)
+    {
+        frame_view_t frame;
+        char *copy = NULL;
+        ok = frame_cache_get(cache, run, &frame) == 0 && (copy = malloc(frame.len)) != NULL;
+        if (!ok)
         {
-            // Second child process: play the audio track
-            play_audio();
+            break;
         }
-        else
+        memcpy(copy, frame.data, frame.len);
+        for (size_t i = 0; prev != NULL && i < frame.len && i < prev_len; i++)
         {
-            // Parent process: wait for both child processes to complete
-            int status;
-            waitpid(pid, &status, 0);  // Wait for frame display to finish
-            waitpid(pid2, &status, 0); // Wait for audio playback to finish
+            changed += copy[i] != prev[i];
         }
+        free(prev);
+        prev = copy;
+        prev_len = frame.len;
     }
+    free(prev);
+    frame_cache_destroy(cache);
+    int count = idx.count;
+    frame_index_free(&idx);
+    return ok && count > 1 ? (double)changed / (count - 1) : -1;
 }
 
 /**
- * Empty a directory by removing all its files and subdirectories
+ * Benchmark conversion and playback on a synthetic video
  *
- * This function recursively removes all contents of the specified directory
- * without removing the directory itself. It handles both files (using unlink)
- * and subdirectories (recursively emptying then using rmdir).
+ * A deterministic, self-contained workload (no input media or external tools
+ * needed) used to compare builds and to train the profile-guided build
+ * (make pgo). Frames of WIDTH pixels are generated, converted through the
+ * normal frame store, then played back headless to stdout with no frame
+ * pacing and no audio. Timings go to stderr, and the generated assets are
+ * removed afterwards. They are named after the process (".bench-<pid>"),
+ * which no converted video is, so a library video called "bench" is left
+ * alone and a benchmark never waits on its conversion.
  *
- * @param dir_name Path to the directory to be emptied
+ * @param frames Number of frames to generate
  */
-void empty_directory(const char *dir_name)
+void run_bench(int frames)
 {
-    // Validate input parameter
-    if (dir_name == NULL)
+    int width = atoi(WIDTH);
+    int height = width * 9 / 16;
+    snprintf(VIDEO_NAME, sizeof(VIDEO_NAME), ".bench-%ld", (long)getpid());
+
+    create_dir(ASSETS_DIR);
+    create_dir(ASCII_DIR);
+    create_dir(FRAMES_DIR);
+    open_work_dir();
+    remove_video_frames(VIDEO_NAME);
+
+    uint8_t *row = malloc(width);
+    if (row == NULL)
     {
-        fatal_error("Invalid directory name provided, path is NULL");
+        fatal_error("Memory allocation failed for benchmark frame");
     }
-
-    // Open the directory
-    DIR *dir = opendir(dir_name);
-    if (dir)
+    for (int t = 0; t < frames; t++)
     {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL)
+        char path[PATH_MAX];
+        frame_path(path, sizeof(path), WORK_DIR, t + 1, ".pgm");
+        if (write_bench_frame(path, t, width, height, row) != 0)
         {
-            // Skip the special directories "." and ".."
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            {
-                continue;
-            }
+            fatal_error("Failed to write benchmark frame %s", path);
+        }
+    }
+    free(row);
 
-            // Construct full path to the current entry
-            char path[PATH_MAX];
-            snprintf(path, sizeof(path), "%s/%s", dir_name, entry->d_name);
+    // Conversion: the same stage body as a real conversion, with extraction done
+    double start = now_seconds();
+    if (batch_convert_to_ascii(-1) != EXIT_SUCCESS)
+    {
+        fatal_error("Benchmark conversion failed");
+    }
+    commit_conversion();
+    double converted = now_seconds();
 
-            // Get information about the current entry
-            struct stat st;
-            if (stat(path, &st) == 0)
-            {
-                if (S_ISDIR(st.st_mode))
-                {
-                    // Handle subdirectory: recursively empty then remove it
-                    empty_directory(path);
-                    rmdir(path);
-                }
-                else
-                {
-                    // Handle regular file: delete it
-                    unlink(path);
-                }
-            }
-        }
-        // Close the directory handle
-        closedir(dir);
+    // Playback: every frame drawn back to back
+    HEADLESS = 1;
+    draw_frames();
+    fflush(stdout);
+    double played = now_seconds();
+
+    char summary[BUFFER_SIZE];
+    dedup_summary(VIDEO_NAME, summary, sizeof(summary));
+    fprintf(stderr, "Bench: %d frames of %dx%d (%s)\n", frames, width, height, summary);
+    fprintf(stderr, "Bench: convert %.3f s (%.1f frames/s), play %.3f s (%.1f frames/s)\n",
+            converted - start, frames / (converted - start),
+            played - converted, frames / (played - converted));
+    fprintf(stderr, "Bench: %.0f cells changed per frame (--stabilize %s)\n",
+            changed_cells_per_frame(), STABILIZE);
+
+    // Nothing else ever uses this name: its lock file goes too
+    char lock[PATH_MAX + sizeof(FRAMES_DIR) + sizeof(".lock")];
+    remove_video_frames(VIDEO_NAME);
+    snprintf(lock, sizeof(lock), "%s/%s.lock", FRAMES_DIR, VIDEO_NAME);
+    unlink(lock);
+}
+
+/**
+ * Remove the extracted and converted frames of a video, its frame timestamps
+ * and its frame index
+ *
+ * @param name Video name
+ */
+void remove_video_frames(const char *name)
+{
+    char pattern[PATH_MAX + sizeof("_gray_*.pgm*")];
+    snprintf(pattern, sizeof(pattern), "%s_gray_*.pgm*", name); // with partly written .tmp files
+    remove_matching(FRAMES_DIR, pattern);
+    snprintf(pattern, sizeof(pattern), "%s.pts", name);
+    remove_matching(FRAMES_DIR, pattern);
+    snprintf(pattern, sizeof(pattern), "%s_gray_*.t[xm][tp]", name); // .txt and .tmp
+    remove_matching(ASCII_DIR, pattern);
+    snprintf(pattern, sizeof(pattern), "%s.idx", name);
+    remove_matching(ASCII_DIR, pattern);
+    snprintf(pattern, sizeof(pattern), "%s.journal", name);
+    remove_matching(ASCII_DIR, pattern);
+    snprintf(pattern, sizeof(pattern), "%s.job", name);
+    remove_matching(ASCII_DIR, pattern);
+}
+
+/* Lock on the current video's name while its conversion runs, and the process holding it */
+static int work_lock_fd = -1;
+static pid_t work_owner;
+
+static void close_work_dir_at_exit(void)
+{
+    // Stage processes exit through here too: only the converting process cleans up
+    if (getpid() == work_owner)
+    {
+        close_work_dir();
     }
 }
 
 /**
- * Create a directory if it doesn't already exist
+ * Remove the working directories that killed conversions of a video left behind
  *
- * This function checks if the specified directory exists, and if not,
- * creates it with standard permissions (0755 = rwxr-xr-x).
+ * Only directories are removed: the pattern of a video's working directories
+ * also matches the lock files of other videos ("x.??????" matches "x.a.lock",
+ * the lock of video "x.a"), while no other video's working directory can
+ * match it, theirs having a longer suffix.
  *
- * @param dir_name Path to the directory to create
+ * @param name Video name
  */
-void create_dir(const char *dir_name)
+static void remove_stale_work_dirs(const char *name)
 {
-    // Validate input parameter
-    if (dir_name == NULL)
+    DIR *dir = opendir(FRAMES_DIR);
+    if (dir == NULL)
     {
-        fatal_error("Invalid directory name provided, path is NULL");
+        return;
     }
 
-    // Check if directory already exists
-    struct stat st = {0};
-    if (stat(dir_name, &st) != 0)
+    char pattern[PATH_MAX + sizeof(".??????")];
+    snprintf(pattern, sizeof(pattern), "%s.??????", name); // mkdtemp() suffixes
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
     {
-        // Directory doesn't exist, create it with permissions 0755 (rwxr-xr-x)
-        if (mkdir(dir_name, 0755) == -1)
+        if (fnmatch(pattern, entry->d_name, 0) != 0)
         {
-            // Handle directory creation failure
-            fatal_error("Failed to create directory: %s (Error: %s)",
-                        dir_name, strerror(errno));
+            continue;
+        }
+        int sub = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (sub != -1)
+        {
+            empty_directory_fd(sub);
+            unlinkat(dirfd(dir), entry->d_name, AT_REMOVEDIR);
         }
     }
-    // If directory already exists, nothing needs to be done
+    closedir(dir);
 }
+
 /**
- * Generate a detailed usage message with instructions and examples
+ * Claim the current video for conversion and give it a private working directory
  *
- * This function creates a formatted help message that describes all available
- * command-line options with their defaults and provides usage examples.
- * The returned string must be freed by the caller to prevent memory leaks.
- *
- * @param program_name The name of the program (usually argv[0])
- * @return A dynamically allocated string containing the usage message
+ * The intermediate frames (and VFR timestamp log) of the conversion go to a
+ * fresh directory under FRAMES_DIR, WORK_DIR, so the converter only ever
+ * sees this conversion's frames and other conversions running at the same
+ * time never see them. A lock on the video's name keeps a second conversion
+ * of the same video from writing the same ASCII frames; holding it, the
+ * working directories that conversions of this video killed earlier left
+ * behind are removed. The working directory is removed again by
+ * close_work_dir(), or at exit if the conversion fails.
  */
-char *get_usage_msg(const char *program_name)
+void open_work_dir()
 {
-    // Allocate memory for the usage message
-    char *usage = malloc(BUFFER_SIZE); // Allocate enough space for the message
-    if (usage == NULL)
+    char path[PATH_MAX + sizeof(FRAMES_DIR) + sizeof(".lock")];
+    snprintf(path, sizeof(path), "%s/%s.lock", FRAMES_DIR, VIDEO_NAME);
+    work_lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (work_lock_fd == -1)
     {
-        fatal_error("Memory allocation failed for usage message");
+        fatal_error("Failed to create %s: %s", path, strerror(errno));
+    }
+    // Another run's busy_videos() may hold the lock for an instant: try again
+    // shortly before concluding the video is being converted
+    for (int attempt = 0; flock(work_lock_fd, LOCK_EX | LOCK_NB) != 0; attempt++)
+    {
+        if (errno != EWOULDBLOCK || attempt == 2)
+        {
+            user_fatal("%s is already being converted by another sm", VIDEO_NAME);
+        }
+        struct timespec pause = {0, 10 * 1000 * 1000};
+        nanosleep(&pause, NULL);
     }
 
-    // Format the string with program_name and default values
-    // This includes all command-line options, their descriptions, defaults, and examples
-    snprintf(usage, BUFFER_SIZE,
-             "Usage: %s [OPTIONS]\n\n"
-             "Options:\n"
-             "  -i, --input FILE       Path to a video file to process\n"
-             "  -f, --fps N            Frames per second (default: %s)\n"
-             "  -w, --width N          Width in characters (default: %s)\n"
-             "  -t, --height N         Height in characters (default: %s)\n"
-             "  -s, --start TIME       Start time in HH:MM:SS format (default: %s)\n"
-             "  -d, --duration SEC     Duration in seconds (default: full video)\n"
-             "  -p, --play NAME        Play a previously converted video by name\n"
-             "  -r, --reset            Reset all settings and delete all extracted files\n"
-             "                         WARNING: This will permanently delete all videos!\n"
-             "  -h, --help             Display this help message\n\n"
-             "Examples:\n"
-             "  %s -p rr               Play the default \"rickroll\" video\n"
-             "  %s -i video.mp4        Convert and play a new video\n"
-             "  %s -i video.mp4 -s 00:01:30 -d 10  Start at 1:30, play for 10 seconds\n",
-             program_name, DEFAULT_FPS, DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_START_TIME,
-             program_name, program_name, program_name);
+    remove_stale_work_dirs(VIDEO_NAME);
 
-    return usage;
+    if (snprintf(WORK_DIR, sizeof(WORK_DIR), "%s/%s.XXXXXX", FRAMES_DIR, VIDEO_NAME) >= (int)sizeof(WORK_DIR) ||
+        mkdtemp(WORK_DIR) == NULL)
+    {
+        fatal_error("Failed to create a working directory in %s: %s", FRAMES_DIR, strerror(errno));
+    }
+
+    static int registered = 0;
+    if (!registered)
+    {
+        atexit(close_work_dir_at_exit);
+        registered = 1;
+    }
+    work_owner = getpid();
+}
+
+/**
+ * Remove the working directory with its intermediate frames and release the video
+ *
+ * Safe to call when no working directory is open.
+ */
+void close_work_dir()
+{
+    if (strcmp(WORK_DIR, FRAMES_DIR) != 0)
+    {
+        empty_directory(WORK_DIR);
+        rmdir(WORK_DIR);
+        snprintf(WORK_DIR, sizeof(WORK_DIR), "%s", FRAMES_DIR);
+    }
+    if (work_lock_fd != -1)
+    {
+        close(work_lock_fd);
+        work_lock_fd = -1;
+    }
 }
 
 /**
- * Extract audio track from the input video file
+ * List the videos being converted, by this run or any other
  *
- * This function uses ffmpeg to extract the audio component from the specified
- * video file and saves it as an MP3 file. It runs ffmpeg in a child process
- * with a progress spinner displayed to the user. The audio extraction respects
- * the START_TIME and DURATION parameters.
+ * A conversion holds the lock file of its video (see open_work_dir()), so a
+ * lock that cannot be shared is held. Probing takes the lock for an instant,
+ * which open_work_dir() allows for.
  *
- * Dependencies: ffmpeg must be installed and accessible in the PATH
+ * @param names Receives the names (the caller frees them)
+ * @return Number of names
  */
-void extract_audio()
+static size_t busy_videos(char (**names)[NAME_MAX + 1])
 {
-    // Fork a child process to handle the ffmpeg execution
-    pid_t pid = fork();
-    if (pid == 0) // Child process
+    *names = NULL;
+    DIR *dir = opendir(FRAMES_DIR);
+    if (dir == NULL)
     {
-        // Construct output path for the extracted audio file
-        char out[PATH_MAX + sizeof(AUDIO_DIR) + sizeof("/.mp3") + sizeof(VIDEO_NAME)];
-        snprintf(out, sizeof(out), AUDIO_DIR "/%s.mp3", VIDEO_NAME);
+        return 0;
+    }
 
-        // Remove existing file to prevent ffmpeg prompt about overwriting
-        if (access(out, F_OK) == 0)
+    size_t count = 0, cap = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t len = strlen(entry->d_name);
+        if (len <= strlen(".lock") || strcmp(entry->d_name + len - strlen(".lock"), ".lock") != 0)
         {
-            unlink(out); // Remove the existing file
+            continue;
         }
-
-        // Prepare ffmpeg command arguments
-        char *args[20]; // Array to hold command and arguments
-        int arg_count = 0;
-
-        // Basic ffmpeg setup with quiet logging and input file
-        args[arg_count++] = "ffmpeg";
-        args[arg_count++] = "-loglevel";
-        args[arg_count++] = "quiet";
-        args[arg_count++] = "-ss";
-        args[arg_count++] = START_TIME; // Starting timestamp from config
-        args[arg_count++] = "-i";
-        args[arg_count++] = VIDEO_PATH; // Input video path
-
-        // Add duration parameter if specified (non-zero)
-        if (atoi(DURATION) > 0)
+        int fd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd == -1)
         {
-            args[arg_count++] = "-t";
-            args[arg_count++] = DURATION;
+            continue;
         }
-
-        // Audio extraction parameters
-        args[arg_count++] = "-vn";        // No video
-        args[arg_count++] = "-acodec";    // Audio codec
-        args[arg_count++] = "libmp3lame"; // Use MP3 encoder
-        args[arg_count++] = "-q:a";       // Audio quality
-        args[arg_count++] = "2";          // High quality (0-9, lower is better)
-        args[arg_count++] = out;          // Output file path
-        args[arg_count++] = NULL;         // Terminate the arguments list
-
-        // Execute ffmpeg with the prepared arguments
-        execvp("ffmpeg", args);
-        _exit(EXIT_FAILURE); // Only reached if execvp fails
-    }
-    else if (pid < 0) // Fork failed
-    {
-        fatal_error("fork() failed: %s", strerror(errno));
-    }
-    else // Parent process
-    {
-        // Display spinner while ffmpeg is running
-        spinner_t *sp = spinner_create("Extracting audio");
-        spinner_start(sp);
-
-        // Wait for child process to complete
-        int status;
-        waitpid(pid, &status, 0);
-
-        // Stop spinner with success/failure indication
-        spinner_stop(sp, WIFEXITED(status) && WEXITSTATUS(status) == 0);
-        spinner_destroy(sp);
-
-        // Handle errors if ffmpeg failed
-        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        int held = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+        close(fd); // releases the probe's lock
+        if (!held)
         {
-            // Check if the error is due to missing input file
-            if (!dir_contains(".", VIDEO_PATH))
-            {
-                user_fatal("Video file not found: %s", VIDEO_PATH);
-            }
-            else
+            continue;
+        }
+        if (count == cap)
+        {
+            cap = cap ? cap * 2 : 8;
+            char(*grown)[NAME_MAX + 1] = realloc(*names, cap * sizeof(**names));
+            if (grown == NULL)
             {
-                fatal_error("Failed to extract audio");
+                fatal_error("Memory allocation failed for the disk budget");
             }
+            *names = grown;
         }
+        snprintf((*names)[count++], NAME_MAX + 1, "%.*s", (int)(len - strlen(".lock")), entry->d_name);
     }
+    closedir(dir);
+    return count;
 }
 
 /**
- * Extract grayscale frames from the input video file
+ * Keep the converted-video library within the disk budget
  *
- * This function uses ffmpeg to extract frames from the video file at the specified
- * FPS rate, converting them to grayscale and resizing them based on the configured
- * width. Each frame is saved as a separate PNG file in the FRAMES_DIR directory.
- * The frame extraction respects the START_TIME and DURATION parameters.
+ * Evicts whole videos (frames, ASCII frames, frame index and audio), least
+ * recently played first, until the library fits in DISK_BUDGET with room for
+ * `incoming` more videos of its average size, and the disk has that room
+ * free too. Videos being converted, here or by another run, are never
+ * evicted. Nothing is asked; each eviction is reported. Does nothing when
+ * no budget is set.
  *
- * Dependencies: ffmpeg must be installed and accessible in the PATH
+ * @param keep Names of videos that must not be evicted
+ * @param nkeep Number of names in keep
+ * @param incoming Number of videos about to be converted
  */
-void extract_images_grayscale()
+void enforce_disk_budget(const char *const *keep, size_t nkeep, int incoming)
 {
-    // Fork a child process to handle the ffmpeg execution
-    pid_t pid = fork();
-    if (pid == 0) // Child process
+    size_t budget = 0;
+    if (parse_size(DISK_BUDGET, &budget) != 0 || budget == 0)
     {
-        // Construct output pattern for the extracted frames
-        // %04d will be replaced by ffmpeg with a 4-digit frame number (0001, 0002, etc.)
-        char output_pattern[PATH_MAX + sizeof(FRAMES_DIR) + sizeof("_gray_%%04d.png")];
-        snprintf(output_pattern, sizeof(output_pattern),
-                 "%s/%s_gray_%%04d.png", FRAMES_DIR, VIDEO_NAME);
-
-        // Prepare ffmpeg command arguments
-        char *args[20]; // Array to hold command and arguments
-        int arg_count = 0;
-
-        // Basic ffmpeg setup with quiet logging and input file
-        args[arg_count++] = "ffmpeg";
-        args[arg_count++] = "-loglevel";
-        args[arg_count++] = "quiet";
-        args[arg_count++] = "-ss";
-        args[arg_count++] = START_TIME; // Starting timestamp from config
-        args[arg_count++] = "-i";
-        args[arg_count++] = VIDEO_PATH; // Input video path
-
-        // Add duration parameter if specified (non-zero)
-        if (atoi(DURATION) > 0)
-        {
-            args[arg_count++] = "-t";
-            args[arg_count++] = DURATION;
-        }
-
-        // Video filter chain to:
-        // 1. Set the frame rate (fps)
-        // 2. Scale the width while maintaining aspect ratio (-1)
-        // 3. Convert to grayscale format
-        args[arg_count++] = "-vf";
-        char vf[BUFFER_SIZE];
-        snprintf(vf, sizeof(vf), "fps=%s,scale=%s:-1,format=gray", FPS, WIDTH);
-        args[arg_count++] = vf;
-
-        // Output pattern for the extracted frames
-        args[arg_count++] = output_pattern;
-        args[arg_count++] = NULL; // Terminate the arguments list
-
-        // Execute ffmpeg with the prepared arguments
-        execvp("ffmpeg", args);
-        _exit(EXIT_FAILURE); // Only reached if execvp fails
+        return;
     }
-    else if (pid < 0) // Fork failed
+
+    // Nor may the videos other runs are converting right now
+    char(*busy)[NAME_MAX + 1] = NULL;
+    size_t nbusy = busy_videos(&busy);
+    const char **kept = malloc((nkeep + nbusy + 1) * sizeof(*kept));
+    if (kept == NULL)
     {
-        fatal_error("fork() failed: %s", strerror(errno));
+        fatal_error("Memory allocation failed for the disk budget");
     }
-    else // Parent process
+    memcpy(kept, keep, nkeep * sizeof(*kept));
+    for (size_t i = 0; i < nbusy; i++)
     {
-        // Display spinner while ffmpeg is running
-        spinner_t *sp = spinner_create("Extracting frames");
-        spinner_start(sp);
-
-        // Wait for child process to complete
-        int status;
-        waitpid(pid, &status, 0);
-
-        // Stop spinner with success/failure indication
-        spinner_stop(sp, WIFEXITED(status) && WEXITSTATUS(status) == 0);
-        spinner_destroy(sp);
+        kept[nkeep + i] = busy[i];
+    }
 
-        // Handle errors if ffmpeg failed
-        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
-        {
-            // Check if the error is due to missing input file
-            if (!dir_contains(".", VIDEO_PATH))
-            {
-                user_fatal("Video file not found: %s", VIDEO_PATH);
-            }
-            else
-            {
-                fatal_error("Failed to extract frames");
-            }
-        }
+    static const char *const dirs[] = {FRAMES_DIR, ASCII_DIR, AUDIO_DIR};
+    library_video_t *evicted;
+    size_t count;
+    int ret = library_evict(dirs, sizeof(dirs) / sizeof(dirs[0]), budget, incoming,
+                            kept, nkeep + nbusy, &evicted, &count);
+    free(kept);
+    free(busy);
+    if (ret != 0)
+    {
+        user_warning("Cannot read the video library, disk budget not enforced");
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        user_info("Evicted %s (%.1f MB, least recently played) to stay within %s",
+                  evicted[i].name, evicted[i].bytes / (1024.0 * 1024.0), DISK_BUDGET);
     }
+    free(evicted);
 }
+
 /**
- * Convert all extracted video frames to ASCII art
+ * Record that a video was just played
  *
- * This function processes all PNG frames in FRAMES_DIR directory and converts them
- * to ASCII art text files using jp2a. The conversion happens in a separate
- * child process, with each frame being converted by a dedicated grandchild process.
- * A spinner is displayed during conversion to provide visual feedback to the user.
+ * Touches one of its files (the frame index, or for older conversions the
+ * audio or first frame), which is what the disk budget orders eviction by.
+ *
+ * @param name Video name
+ */
+void mark_played(const char *name)
+{
+    char path[PATH_MAX + sizeof(ASCII_DIR "/_gray_0001.txt")];
+    index_path(path, sizeof(path), name);
+    if (library_touch(path) == 0)
+    {
+        return;
+    }
+    if (audio_path(path, sizeof(path), name) == 0 && library_touch(path) == 0)
+    {
+        return;
+    }
+    snprintf(path, sizeof(path), ASCII_DIR "/%s_gray_0001.txt", name);
+    library_touch(path);
+}
+
+/**
+ * Remove files in a directory whose names match a pattern
  *
- * Process structure:
- * - Parent process: Shows spinner and waits for completion
- * - Child process: Iterates through frames and manages conversion
- * - Grandchild processes: Convert individual frames using jp2a
+ * Matching subdirectories are removed with everything in them.
  *
- * Dependencies: jp2a must be installed and accessible in the PATH
+ * @param dir_path Directory to clean
+ * @param pattern fnmatch pattern selecting the files to remove
  */
-void batch_convert_to_ascii()
+void remove_matching(const char *dir_path, const char *pattern)
 {
-    // Fork a child process to handle the conversion work
-    pid_t pid = fork();
-    if (pid < 0)
-        fatal_error("fork() failed: %s", strerror(errno));
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL)
+    {
+        return;
+    }
 
-    if (pid == 0) // Child process
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
     {
-        // Open the frames directory to iterate through its contents
-        DIR *dir = opendir(FRAMES_DIR);
-        if (dir == NULL)
+        if (fnmatch(pattern, entry->d_name, 0) != 0 || unlinkat(dirfd(dir), entry->d_name, 0) == 0 ||
+            (errno != EISDIR && errno != EPERM))
         {
-            fatal_error("Failed to open directory: %s", FRAMES_DIR);
+            continue;
         }
-
-        // Iterate through all entries in the directory
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL)
+        int sub = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (sub != -1)
         {
-            // Skip the special directories "." and ".."
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            {
-                continue;
-            }
-
-            // Check if the file has a .png extension
-            char *ext = strrchr(entry->d_name, '.');
-            if (ext == NULL || strncmp(ext, ".png", 4) != 0)
-            {
-                continue;
-            }
-
-            // Prepare input and output paths for the conversion
-            char input_path[PATH_MAX];
-            char output_path[PATH_MAX + sizeof(ASCII_DIR) + sizeof(".txt")];
-
-            // Extract the base name from the file (without extension)
-            char base_name[PATH_MAX];
-            strncpy(base_name, entry->d_name, ext - entry->d_name);
-            base_name[ext - entry->d_name] = '\0';
-
-            // Construct full paths for input PNG and output ASCII file
-            snprintf(input_path, sizeof(input_path), "%s/%s", FRAMES_DIR, entry->d_name);
-            snprintf(output_path, sizeof(output_path), "%s/%s.txt", ASCII_DIR, base_name);
-
-            // Fork another process to handle the conversion of this specific frame
-            pid_t child_pid = fork();
-            if (child_pid == 0) // Grandchild process
-            {
-                // Format the output argument for jp2a
-                char output_arg[sizeof(output_path) + sizeof("--output=")];
-                snprintf(output_arg, sizeof(output_arg), "--output=%s", output_path);
-
-                // Execute jp2a to convert the image to ASCII
-                execlp("jp2a", "jp2a", output_arg, input_path, NULL);
-                _exit(EXIT_FAILURE); // Only reached if execlp fails
-            }
-            else // Original child process
-            {
-                // Wait for the conversion of this frame to complete
-                int status;
-                waitpid(child_pid, &status, 0);
-            }
+            empty_directory_fd(sub);
+            unlinkat(dirfd(dir), entry->d_name, AT_REMOVEDIR);
         }
-
-        // Clean up and exit the child process
-        closedir(dir);
-        exit(EXIT_SUCCESS);
-    }
-    else // Parent process
-    {
-        // Display a spinner while the conversion is in progress
-        spinner_t *sp = spinner_create("Rendering ASCII art");
-        spinner_start(sp);
-
-        // Wait for the child process to complete all conversions
-        waitpid(pid, NULL, 0);
-
-        // Stop the spinner and clean up
-        spinner_stop(sp, true);
-        spinner_destroy(sp);
     }
+    closedir(dir);
 }
 
 /**
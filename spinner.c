@@ -7,22 +7,34 @@
 #include <unistd.h>
 
 struct spinner {
-    char       *msg;
-    const char *symbols;
-    size_t      symcount;
-    size_t      idx;
-    bool        active;
-    pthread_t   tid;
+    char           *msg;
+    const char     *symbols;
+    size_t          symcount;
+    size_t          idx;
+    bool            active;
+    bool            dirty;  // msg changed since it was last printed
+    pthread_mutex_t lock;   // guards msg and dirty
+    pthread_t       tid;
 };
 
 static void *spinner_thread(void *arg) {
     spinner_t *s = arg;
     // print initial message
+    pthread_mutex_lock(&s->lock);
     printf(ANSI_BOLD ANSI_BLUE "%s…" ANSI_RESET " ", s->msg);
+    s->dirty = false;
+    pthread_mutex_unlock(&s->lock);
     fflush(stdout);
 
     while (s->active) {
         char c = s->symbols[s->idx++ % s->symcount];
+        pthread_mutex_lock(&s->lock);
+        if (s->dirty) {
+            // redraw the whole line with the new message
+            printf("\r\033[K" ANSI_BOLD ANSI_BLUE "%s…" ANSI_RESET " ", s->msg);
+            s->dirty = false;
+        }
+        pthread_mutex_unlock(&s->lock);
         printf(ANSI_BLUE "\b%c", c);
         fflush(stdout);
         usleep(100000); // 100 ms
@@ -38,9 +50,26 @@ spinner_t *spinner_create(const char *msg) {
     s->symcount = strlen(s->symbols);
     s->idx      = 0;
     s->active   = false;
+    s->dirty    = false;
+    pthread_mutex_init(&s->lock, NULL);
     return s;
 }
 
+void spinner_set_msg(spinner_t *s, const char *msg) {
+    if (!s || !msg) return;
+    char *copy = strdup(msg);
+    if (!copy) return;
+    pthread_mutex_lock(&s->lock);
+    if (strcmp(s->msg, copy) == 0) {
+        free(copy);
+    } else {
+        free(s->msg);
+        s->msg   = copy;
+        s->dirty = true;
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
 void spinner_start(spinner_t *s) {
     if (!s) return;
     s->active = true;
@@ -51,6 +80,11 @@ void spinner_stop(spinner_t *s, bool success) {
     if (!s) return;
     s->active = false;
     pthread_join(s->tid, NULL);
+    // flush a message update the thread did not get to draw
+    if (s->dirty) {
+        printf("\r\033[K" ANSI_BOLD ANSI_BLUE "%s…" ANSI_RESET "  ", s->msg);
+        s->dirty = false;
+    }
     // backspace over last spinner char and print result
     printf("\b");
     if (success) {
@@ -63,6 +97,7 @@ void spinner_stop(spinner_t *s, bool success) {
 
 void spinner_destroy(spinner_t *s) {
     if (!s) return;
+    pthread_mutex_destroy(&s->lock);
     free(s->msg);
     free(s);
 }
\ No newline at end of file
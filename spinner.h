@@ -12,6 +12,9 @@ spinner_t *spinner_create(const char *msg);
 // Start the spinner in a background thread
 void spinner_start(spinner_t *s);
 
+// Replace the message shown next to the spinner (safe while it is running)
+void spinner_set_msg(spinner_t *s, const char *msg);
+
 // Stop the spinner, print a green check or red X based on `success`
 void spinner_stop(spinner_t *s, bool success);
 
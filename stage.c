@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stage.h"
+#include "spinner.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+enum stage_state { PENDING, RUNNING, DONE, FAILED };
+
+struct stage_slot {
+    enum stage_state state;
+    pid_t            pid;
+    int              notify_fd; // write end of this stage's upstream pipe, or -1
+};
+
+// Fork stage `i`. The child closes every notify pipe the runner holds so that
+// its own upstream pipe reaches EOF once the runner closes the write end.
+static int start_stage(const stage_t *stages, struct stage_slot *slots,
+                       size_t count, size_t i) {
+    int fds[2] = { -1, -1 };
+    int producer = stages[i].streams_from;
+
+    // A producer that has already finished needs no pipe: -1 means "done"
+    if (producer != STAGE_NONE && slots[producer].state == RUNNING) {
+        if (pipe(fds) == -1) return -1;
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (fds[0] != -1) { close(fds[0]); close(fds[1]); }
+        return -1;
+    }
+    if (pid == 0) {
+        for (size_t j = 0; j < count; j++) {
+            if (slots[j].notify_fd != -1) close(slots[j].notify_fd);
+        }
+        if (fds[1] != -1) close(fds[1]);
+        _exit(stages[i].run(fds[0]));
+    }
+
+    if (fds[0] != -1) close(fds[0]);
+    slots[i].notify_fd = fds[1];
+    slots[i].pid = pid;
+    slots[i].state = RUNNING;
+    return 0;
+}
+
+static bool stage_ready(const stage_t *st, const struct stage_slot *slots) {
+    if (st->after != STAGE_NONE && slots[st->after].state != DONE) return false;
+    if (st->streams_from != STAGE_NONE && slots[st->streams_from].state == PENDING) return false;
+    return true;
+}
+
+static void describe(const stage_t *stages, const struct stage_slot *slots,
+                     size_t count, const char *title, char *buf, size_t len) {
+    size_t used = (size_t)snprintf(buf, len, "%s", title);
+    for (size_t i = 0; i < count && used < len; i++) {
+        char note[64] = "";
+        if (stages[i].progress && slots[i].state != PENDING) {
+            stages[i].progress(note, sizeof(note));
+        }
+        const char *mark = slots[i].state == DONE    ? " ✔"
+                         : slots[i].state == FAILED  ? " ✖"
+                         : slots[i].state == PENDING ? " (waiting)"
+                         : "";
+        used += (size_t)snprintf(buf + used, len - used, "%s%s%s%s%s",
+                                 i == 0 ? ": " : " | ", stages[i].name,
+                                 note[0] ? " " : "", note, mark);
+    }
+}
+
+int stage_run_all(const stage_t *stages, size_t count, const char *title) {
+    struct stage_slot slots[count];
+    for (size_t i = 0; i < count; i++) {
+        slots[i] = (struct stage_slot){ .state = PENDING, .pid = -1, .notify_fd = -1 };
+    }
+
+    char msg[512];
+    describe(stages, slots, count, title, msg, sizeof(msg));
+    spinner_t *sp = spinner_create(msg);
+    spinner_start(sp);
+
+    int failed = STAGE_NONE;
+    for (;;) {
+        // Launch everything whose dependencies are now satisfied
+        for (size_t i = 0; i < count && failed == STAGE_NONE; i++) {
+            if (slots[i].state == PENDING && stage_ready(&stages[i], slots) &&
+                start_stage(stages, slots, count, i) != 0) {
+                slots[i].state = FAILED;
+                failed = (int)i;
+            }
+        }
+
+        // Reap whatever has finished
+        bool busy = false;
+        for (size_t i = 0; i < count && failed == STAGE_NONE; i++) {
+            if (slots[i].state != RUNNING) {
+                busy |= slots[i].state == PENDING;
+                continue;
+            }
+            int status;
+            pid_t r = waitpid(slots[i].pid, &status, WNOHANG);
+            if (r == 0 || (r == -1 && errno == EINTR)) {
+                busy = true;
+                continue;
+            }
+            if (r == slots[i].pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                slots[i].state = DONE;
+                // Tell consumers streaming from this stage that it is finished
+                for (size_t j = 0; j < count; j++) {
+                    if (stages[j].streams_from == (int)i && slots[j].notify_fd != -1) {
+                        close(slots[j].notify_fd);
+                        slots[j].notify_fd = -1;
+                    }
+                }
+                busy = true; // dependants may be startable now
+            } else {
+                slots[i].state = FAILED;
+                failed = (int)i;
+            }
+        }
+
+        describe(stages, slots, count, title, msg, sizeof(msg));
+        spinner_set_msg(sp, msg);
+        if (failed != STAGE_NONE || !busy) break;
+        nanosleep(&(struct timespec){ .tv_nsec = 100000000 }, NULL); // 100 ms
+    }
+
+    // Abort: terminate and reap every stage still running
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].state == RUNNING) {
+            kill(slots[i].pid, SIGTERM);
+            waitpid(slots[i].pid, NULL, 0);
+            slots[i].state = FAILED;
+        }
+        if (slots[i].notify_fd != -1) close(slots[i].notify_fd);
+    }
+
+    spinner_stop(sp, failed == STAGE_NONE);
+    spinner_destroy(sp);
+    return failed;
+}
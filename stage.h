@@ -0,0 +1,39 @@
+#ifndef STAGE_H
+#define STAGE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define STAGE_NONE  -1   // no dependency
+
+// One unit of work in a pipeline. Each stage runs in its own child process.
+typedef struct {
+    // Short label shown in the combined progress line
+    const char *name;
+
+    // Body of the stage, run in the forked child. Either execs or returns an
+    // exit status. `upstream_fd` is -1 unless the stage streams from another
+    // one, in which case it reaches EOF once that stage has succeeded.
+    int (*run)(int upstream_fd);
+
+    // Index of a stage that must complete successfully before this one
+    // starts, or STAGE_NONE
+    int after;
+
+    // Index of a stage whose output this one consumes while it is still
+    // being produced, or STAGE_NONE. The stage starts as soon as its
+    // producer has started and is told through `upstream_fd` when the
+    // producer is finished.
+    int streams_from;
+
+    // Optional: write a short progress note (e.g. "120 frames") into `buf`
+    void (*progress)(char *buf, size_t len);
+} stage_t;
+
+// Run all stages, starting each one as soon as its dependencies allow, and
+// show a single combined progress line titled `title`. If any stage fails,
+// every other running stage is terminated and reaped.
+// Returns STAGE_NONE on success or the index of the first stage that failed.
+int stage_run_all(const stage_t *stages, size_t count, const char *title);
+
+#endif // STAGE_H
@@ -0,0 +1,218 @@
+#define _DEFAULT_SOURCE
+
+#include "term.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ENTER      "\033[?1049h\033[?25l\033[2J\033[H"  // alternate screen, hidden cursor
+#define LEAVE      "\033[?25h\033[?1049l"
+#define SYNC_BEGIN "\033[?2026h"
+#define SYNC_END   "\033[?2026l"
+#define CLEAR      "\033[2J\033[1;1H"
+#define HOME       "\033[H"
+
+// How long to wait for the terminal to answer the probe
+#define PROBE_TIMEOUT_MS 200
+
+static int sync_state = -1;  // synchronized output: -1 not probed, 0 no, 1 yes
+static int out_fd = -1;
+static pid_t owner;          // process that started presenting (children do not restore)
+static size_t last_len;
+static volatile sig_atomic_t active;
+static volatile sig_atomic_t suspended;
+static volatile sig_atomic_t resized;
+
+static void write_all(int fd, const char *s, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, s, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        s   += n;
+        len -= (size_t)n;
+    }
+}
+
+// Async-signal-safe: only write() and getpid()
+static void restore(void) {
+    if (!active || getpid() != owner) return;
+    if (sync_state == 1) write_all(out_fd, SYNC_END, sizeof(SYNC_END) - 1);
+    write_all(out_fd, LEAVE, sizeof(LEAVE) - 1);
+    active = 0;
+}
+
+static void enter(void) {
+    write_all(out_fd, ENTER, sizeof(ENTER) - 1);
+    active  = 1;
+    resized = 1;  // the first frame clears
+}
+
+static void restore_at_exit(void) {
+    // exit() flushes stdio only after the atexit handlers: get what is left
+    // of the last frame out while still on the alternate screen
+    if (active && getpid() == owner && out_fd == STDOUT_FILENO) fflush(stdout);
+    restore();
+}
+
+// SIGTERM, SIGHUP, SIGQUIT: restore, then terminate as the signal would have
+static void on_fatal_signal(int sig) {
+    int saved = errno;
+    restore();
+    signal(sig, SIG_DFL);
+    raise(sig);  // delivered once the handler returns
+    errno = saved;
+}
+
+static void on_stop(int sig) {
+    int saved = errno;
+    if (active && getpid() == owner) {
+        restore();
+        suspended = 1;
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+    errno = saved;
+}
+
+static void on_continue(int sig) {
+    (void)sig;
+    int saved = errno;
+    signal(SIGTSTP, on_stop);
+    if (suspended && getpid() == owner) {
+        suspended = 0;
+        enter();
+    }
+    errno = saved;
+}
+
+static void on_resize(int sig) {
+    (void)sig;
+    resized = 1;
+}
+
+static void install_handlers(void) {
+    static int installed;
+    if (installed) return;
+    installed = 1;
+    atexit(restore_at_exit);
+
+    struct sigaction sa = { 0 };
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = on_fatal_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGQUIT, &sa, NULL);
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = on_stop;
+    sigaction(SIGTSTP, &sa, NULL);
+    sa.sa_handler = on_continue;
+    sigaction(SIGCONT, &sa, NULL);
+    sa.sa_handler = on_resize;
+    sigaction(SIGWINCH, &sa, NULL);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Whether `reply` holds a primary device attributes report, ESC [ ? ... c
+static int has_device_attributes(const char *reply) {
+    for (const char *at = strstr(reply, "\033[?"); at; at = strstr(at + 1, "\033[?")) {
+        const char *p = at + 3;
+        while ((*p >= '0' && *p <= '9') || *p == ';') p++;
+        if (*p == 'c') return 1;
+    }
+    return 0;
+}
+
+void term_probe(int fd) {
+    sync_state = 0;
+    if (!isatty(fd)) return;
+
+    // Only the foreground job may switch the terminal's mode
+    int tty = open("/dev/tty", O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (tty == -1) return;
+    struct termios saved, raw;
+    if (tcgetpgrp(tty) != getpgrp() || tcgetattr(tty, &saved) != 0) {
+        close(tty);
+        return;
+    }
+    raw = saved;
+    raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    raw.c_cc[VMIN]  = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(tty, TCSANOW, &raw);
+
+    // Report mode 2026 (DECRQM), then the device attributes, which every
+    // terminal answers: once those are in, no mode report is coming
+    static const char query[] = "\033[?2026$p\033[c";
+    char reply[256];
+    size_t used = 0;
+    reply[0] = '\0';
+    write_all(tty, query, sizeof(query) - 1);
+    double deadline = now_ms() + PROBE_TIMEOUT_MS;
+    while (used + 1 < sizeof(reply) && !has_device_attributes(reply)) {
+        int left = (int)(deadline - now_ms());
+        struct pollfd pfd = { .fd = tty, .events = POLLIN };
+        if (left <= 0 || poll(&pfd, 1, left) <= 0) break;
+        ssize_t n = read(tty, reply + used, sizeof(reply) - 1 - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        used += (size_t)n;
+        reply[used] = '\0';
+    }
+    tcsetattr(tty, TCSANOW, &saved);
+    close(tty);
+
+    // ESC [ ? 2026 ; Ps $ y, where 1 (set) and 2 (reset) mean supported
+    const char *at = strstr(reply, "\033[?2026;");
+    sync_state = at && (at[8] == '1' || at[8] == '2') && at[9] == '$';
+}
+
+int term_begin(int fd) {
+    const char *term = getenv("TERM");
+    if (!isatty(fd) || (term && strcmp(term, "dumb") == 0)) return 0;
+    if (sync_state < 0) term_probe(fd);
+
+    out_fd   = fd;
+    owner    = getpid();
+    last_len = 0;
+    install_handlers();
+    enter();
+    return 1;
+}
+
+int term_begin_emulated(int fd) {
+    sync_state = 1;
+    out_fd     = fd;
+    owner      = getpid();
+    last_len   = 0;
+    enter();
+    return 1;
+}
+
+const char *term_frame_start(size_t len) {
+    if (!active) return CLEAR;
+    int clear = resized || len != last_len;
+    resized  = 0;
+    last_len = len;
+    if (sync_state == 1) return clear ? SYNC_BEGIN CLEAR : SYNC_BEGIN HOME;
+    return clear ? CLEAR : HOME;
+}
+
+const char *term_frame_end(void) {
+    return active && sync_state == 1 ? SYNC_END : "";
+}
+
+void term_end(void) {
+    restore();
+}
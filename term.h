@@ -0,0 +1,51 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+
+// Tear-free presentation of playback on a terminal.
+//
+// While active, playback runs on the alternate screen with the cursor hidden,
+// and each frame starts by homing the cursor instead of clearing the screen
+// (the screen is still cleared when the frame's shape changes or the window
+// is resized, so nothing of the previous frame is left around it). Where the
+// terminal supports synchronized output (DEC private mode 2026), each frame
+// is also bracketed by begin/end-update markers so that the terminal shows it
+// whole instead of repainting halfway through.
+//
+// The terminal is restored on every way out of the process that started the
+// presentation: term_end(), exit() (fatal errors included, and the trapped
+// SIGINT where it ends a run), and SIGTERM, SIGHUP and SIGQUIT, which restore
+// and then terminate as they would have. SIGTSTP restores before stopping and
+// SIGCONT picks up again.
+
+// Ask the terminal on `fd` whether it supports synchronized output, waiting
+// at most a fraction of a second for the answer. Call it before anything else
+// reads from the terminal; term_begin() probes itself if this was not done.
+// The result carries over to forked children.
+void term_probe(int fd);
+
+// Start presenting on `fd`. Returns 1 if `fd` is a terminal and presentation
+// is active, 0 otherwise (frames are then written exactly as before: a full
+// clear in front of each).
+int term_begin(int fd);
+
+// Start presenting on `fd` as on a terminal with synchronized output,
+// although `fd` is not one: for output that is applied to an emulated
+// terminal in this process (see vt.h). No signal handlers are installed,
+// since no real terminal needs restoring. Returns 1.
+int term_begin_emulated(int fd);
+
+// Bytes to write in front of a frame of `len` bytes: the begin-update marker
+// and a cursor home, or a full clear when the frame differs in size from the
+// previous one or the window was resized
+const char *term_frame_start(size_t len);
+
+// Bytes to write after a frame: the end-update marker, or ""
+const char *term_frame_end(void);
+
+// Leave the alternate screen and show the cursor again. Safe to call more
+// than once, and when presentation never started.
+void term_end(void);
+
+#endif // TERM_H
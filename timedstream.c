@@ -0,0 +1,370 @@
+#define _DEFAULT_SOURCE
+
+#include "timedstream.h"
+#include "fdcopy.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char raw_magic[8] = { 'S', 'M', 'T', 'S', 1, 0, 0, 0 };
+#define RAW_RECORD_HEADER 12 // u64 due time + u32 length
+
+struct tstream_writer {
+    FILE            *fp;
+    tstream_format_t format;
+    int              failed;
+};
+
+tstream_format_t tstream_format_for_path(const char *path) {
+    const char *dot = path ? strrchr(path, '.') : NULL;
+    return dot && strcmp(dot, ".cast") == 0 ? TSTREAM_CAST : TSTREAM_RAW;
+}
+
+tstream_writer_t *tstream_open(const char *path, tstream_format_t format,
+                               int cols, int rows) {
+    tstream_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->fp = fopen(path, "wb");
+    if (!w->fp) {
+        free(w);
+        return NULL;
+    }
+    w->format = format;
+
+    if (format == TSTREAM_CAST) {
+        fprintf(w->fp, "{\"version\": 2, \"width\": %d, \"height\": %d}\n", cols, rows);
+    } else {
+        fwrite(raw_magic, 1, sizeof(raw_magic), w->fp);
+    }
+    return w;
+}
+
+static void put_le(uint8_t *p, uint64_t v, int n) {
+    for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *p, int n) {
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+// Write `data` as the body of a JSON string
+static void put_json_string(FILE *fp, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)data[i];
+        switch (ch) {
+        case '"':  fputs("\\\"", fp); break;
+        case '\\': fputs("\\\\", fp); break;
+        case '\n': fputs("\\n", fp); break;
+        case '\r': fputs("\\r", fp); break;
+        case '\t': fputs("\\t", fp); break;
+        default:
+            if (ch < 0x20 || ch == 0x7f) fprintf(fp, "\\u%04x", ch);
+            else putc(ch, fp);
+        }
+    }
+}
+
+int tstream_write(tstream_writer_t *w, double seconds, const char *data, size_t len) {
+    if (!w || seconds < 0) return -1;
+
+    if (w->format == TSTREAM_CAST) {
+        fprintf(w->fp, "[%.6f, \"o\", \"", seconds);
+        put_json_string(w->fp, data, len);
+        fputs("\"]\n", w->fp);
+    } else {
+        uint8_t header[RAW_RECORD_HEADER];
+        put_le(header, (uint64_t)(seconds * 1e6 + 0.5), 8);
+        put_le(header + 8, len, 4);
+        fwrite(header, 1, sizeof(header), w->fp);
+        fwrite(data, 1, len, w->fp);
+    }
+    if (ferror(w->fp)) w->failed = 1;
+    return w->failed ? -1 : 0;
+}
+
+int tstream_close(tstream_writer_t *w) {
+    if (!w) return -1;
+    int failed = w->failed;
+    if (fclose(w->fp) != 0) failed = 1;
+    free(w);
+    return failed ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Replay                                                                    */
+/* ------------------------------------------------------------------------- */
+
+struct chunk {
+    double      due;
+    const char *data;
+    size_t      len;
+};
+
+struct recording {
+    char         *file;   // whole file, mapped or (for asciicast) read and decoded in place
+    size_t        size;
+    int           mapped;
+    int           fd;     // the mapped file, for kernel-side copies; -1 for asciicast
+    struct chunk *chunks;
+    size_t        count;
+    size_t        cap;
+};
+
+static int add_chunk(struct recording *r, double due, const char *data, size_t len) {
+    if (r->count == r->cap) {
+        size_t cap = r->cap ? r->cap * 2 : 256;
+        struct chunk *grown = realloc(r->chunks, cap * sizeof(*grown));
+        if (!grown) return -1;
+        r->chunks = grown;
+        r->cap    = cap;
+    }
+    r->chunks[r->count++] = (struct chunk){ due, data, len };
+    return 0;
+}
+
+static int parse_raw(struct recording *r) {
+    const uint8_t *p   = (const uint8_t *)r->file + sizeof(raw_magic);
+    const uint8_t *end = (const uint8_t *)r->file + r->size;
+
+    while (p < end) {
+        if ((size_t)(end - p) < RAW_RECORD_HEADER) return -1;
+        uint64_t usec = get_le(p, 8);
+        size_t   len  = (size_t)get_le(p + 8, 4);
+        p += RAW_RECORD_HEADER;
+        if ((size_t)(end - p) < len) return -1;
+        if (add_chunk(r, (double)usec / 1e6, (const char *)p, len) != 0) return -1;
+        p += len;
+    }
+    return 0;
+}
+
+static int hex4(const char *s, unsigned *out) {
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (unsigned)(c - 'A' + 10);
+        else return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static char *put_utf8(char *o, unsigned cp) {
+    if (cp < 0x80) {
+        *o++ = (char)cp;
+    } else if (cp < 0x800) {
+        *o++ = (char)(0xc0 | cp >> 6);
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *o++ = (char)(0xe0 | cp >> 12);
+        *o++ = (char)(0x80 | (cp >> 6 & 0x3f));
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    } else {
+        *o++ = (char)(0xf0 | cp >> 18);
+        *o++ = (char)(0x80 | (cp >> 12 & 0x3f));
+        *o++ = (char)(0x80 | (cp >> 6 & 0x3f));
+        *o++ = (char)(0x80 | (cp & 0x3f));
+    }
+    return o;
+}
+
+// Decode the JSON string starting after the opening quote at `p` in place.
+// Decoded text is never longer than its encoding, so it is written over the
+// input. Returns the position after the closing quote, or NULL if malformed.
+static char *decode_json_string(char *p, char *end, size_t *len) {
+    char *o = p, *start = p;
+    while (p < end && *p != '"') {
+        if (*p != '\\') {
+            *o++ = *p++;
+            continue;
+        }
+        if (++p >= end) return NULL;
+        char esc = *p++;
+        switch (esc) {
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case '"': case '\\': case '/': *o++ = esc; break;
+        case 'u': {
+            unsigned cp, lo;
+            if (end - p < 4 || hex4(p, &cp) != 0) return NULL;
+            p += 4;
+            // Combine a surrogate pair into one code point
+            if (cp >= 0xd800 && cp < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+                hex4(p + 2, &lo) == 0 && lo >= 0xdc00 && lo < 0xe000) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                p += 6;
+            }
+            o = put_utf8(o, cp);
+            break;
+        }
+        default: return NULL;
+        }
+    }
+    if (p >= end) return NULL;
+    *len = (size_t)(o - start);
+    return p + 1;
+}
+
+static char *skip_space(char *p, char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+// Parse asciicast v2: a header object on the first line, then one
+// [time, type, data] event per line. Only output ("o") events are replayed.
+static int parse_cast(struct recording *r) {
+    char *p = r->file, *end = r->file + r->size;
+    char *nl = memchr(p, '\n', r->size);
+    if (*p != '{' || !nl) return -1;
+    p = nl + 1;
+
+    while (p < end) {
+        char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) line_end = end;
+        char *q = skip_space(p, line_end);
+
+        if (q < line_end) {
+            if (*q++ != '[') return -1;
+            char saved = *line_end; // strtod must not run past the line
+            *line_end = '\0';
+            char *num_end;
+            double due = strtod(q, &num_end);
+            *line_end = saved;
+            if (num_end == q || due < 0) return -1;
+
+            q = skip_space(num_end, line_end);
+            if (q >= line_end || *q != ',') return -1;
+            q = skip_space(q + 1, line_end);
+            int output = line_end - q >= 3 && strncmp(q, "\"o\"", 3) == 0;
+
+            // Skip the type string and find the data string
+            q = memchr(q + 1, '"', (size_t)(line_end - q - 1));
+            if (!q) return -1;
+            q = skip_space(q + 1, line_end);
+            if (q >= line_end || *q != ',') return -1;
+            q = skip_space(q + 1, line_end);
+            if (q >= line_end || *q != '"') return -1;
+
+            size_t len;
+            char *data = q + 1;
+            if (!decode_json_string(data, line_end, &len)) return -1;
+            if (output && add_chunk(r, due, data, len) != 0) return -1;
+        }
+        p = line_end + 1;
+    }
+    return 0;
+}
+
+static int load_recording(struct recording *r, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1) return -1;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(raw_magic)) {
+        close(fd);
+        return -1;
+    }
+    r->size = (size_t)st.st_size;
+
+    char magic[sizeof(raw_magic)];
+    if (pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) {
+        close(fd);
+        return -1;
+    }
+
+    int rc;
+    if (memcmp(magic, raw_magic, sizeof(magic)) == 0) {
+        // Binary stream: replay straight out of the mapping
+        r->file = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (r->file == MAP_FAILED) {
+            close(fd);
+            r->file = NULL;
+            return -1;
+        }
+        r->fd = fd;
+        r->mapped = 1;
+        madvise(r->file, r->size, MADV_SEQUENTIAL);
+        rc = parse_raw(r);
+    } else {
+        // asciicast: decode everything up front so replay does no parsing
+        r->file = malloc(r->size + 1); // room to terminate the last line
+        rc = r->file && pread(fd, r->file, r->size, 0) == (ssize_t)r->size ? 0 : -1;
+        close(fd);
+        if (rc == 0) rc = parse_cast(r);
+    }
+    return rc;
+}
+
+static void free_recording(struct recording *r) {
+    if (r->mapped) munmap(r->file, r->size);
+    else free(r->file);
+    if (r->fd != -1) close(r->fd);
+    free(r->chunks);
+}
+
+static int write_all(int fd, const char *data, size_t len, volatile sig_atomic_t *stop) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR && !(stop && *stop)) continue;
+            return -1;
+        }
+        data += n;
+        len  -= (size_t)n;
+    }
+    return 0;
+}
+
+int tstream_replay(const char *path, int fd, volatile sig_atomic_t *stop) {
+    struct recording r = { .fd = -1 };
+    if (!path || load_recording(&r, path) != 0) {
+        free_recording(&r);
+        return -1;
+    }
+
+    // Binary chunks sit in the file as they are written out, so unless the
+    // output is a terminal the kernel can copy them across directly
+    fdcopy_t out;
+    int direct = r.fd != -1 && fdcopy_init(&out, fd) == 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int rc = 0;
+    for (size_t i = 0; i < r.count && rc == 0 && !(stop && *stop); i++) {
+        const struct chunk *c = &r.chunks[i];
+
+        // Sleep until this chunk is due, measured from the start of replay
+        long long ns = start.tv_nsec + (long long)(c->due * 1e9);
+        struct timespec due = {
+            .tv_sec  = start.tv_sec + (time_t)(ns / 1000000000),
+            .tv_nsec = (long)(ns % 1000000000),
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR) {
+            if (stop && *stop) break;
+        }
+        if (stop && *stop) break;
+
+        if (direct) {
+            rc = fdcopy_send(&out, r.fd, c->data - r.file, c->len);
+        } else {
+            rc = write_all(fd, c->data, c->len, stop);
+        }
+    }
+    free_recording(&r);
+    return rc;
+}
@@ -0,0 +1,40 @@
+#ifndef TIMEDSTREAM_H
+#define TIMEDSTREAM_H
+
+#include <signal.h>
+#include <stddef.h>
+
+// A recording of the exact bytes playback writes to the terminal, each chunk
+// stamped with the time it is due, so a video can be rendered once and then
+// replayed without touching the frame files again.
+//
+// Two encodings are supported:
+//  - asciicast v2 (".cast"), readable by asciinema and other players
+//  - a compact binary stream: the magic "SMTS\1\0\0\0" followed by records of
+//    a little-endian u64 due time in microseconds, a u32 length, and the bytes
+typedef enum {
+    TSTREAM_RAW,
+    TSTREAM_CAST,
+} tstream_format_t;
+
+typedef struct tstream_writer tstream_writer_t;
+
+// Pick the format from a file name: ".cast" means asciicast, anything else raw
+tstream_format_t tstream_format_for_path(const char *path);
+
+// Create `path` for a terminal of `cols` x `rows`. Returns NULL on error.
+tstream_writer_t *tstream_open(const char *path, tstream_format_t format,
+                               int cols, int rows);
+
+// Append `len` bytes due `seconds` after the start. Returns 0 or -1.
+int tstream_write(tstream_writer_t *w, double seconds, const char *data, size_t len);
+
+// Flush and close; returns -1 if anything failed to reach the file
+int tstream_close(tstream_writer_t *w);
+
+// Write the recording in `path` to `fd`, sleeping until each chunk is due.
+// Stops early once `*stop` becomes non-zero (if given). Returns 0 on success,
+// -1 if the file cannot be read or is malformed, or a write fails.
+int tstream_replay(const char *path, int fd, volatile sig_atomic_t *stop);
+
+#endif // TIMEDSTREAM_H
@@ -0,0 +1,374 @@
+#include "vt.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PARAMS 16
+#define TAB_STOP   8
+
+enum { GROUND, ESCAPE, ESCAPE_INTER, CSI, STRING, STRING_ESC };
+
+struct vt {
+    int   rows, cols;
+    char *main, *alt;       // rows * cols cells each
+    char *screen;           // the one shown: main or alt
+    int   row, col;         // cursor, 0-based
+    int   wrap_pending;     // last column written: the next character wraps
+    int   autowrap;
+    int   saved_row, saved_col;
+
+    int   state;
+    int   params[MAX_PARAMS];
+    int   nparams;
+    char  marker;           // CSI private marker ('?', '>', ...) or 0
+    char  inter;            // last intermediate byte or 0
+    vt_stats_t stats;
+};
+
+static void blank(char *cells, size_t n) {
+    memset(cells, ' ', n);
+}
+
+vt_t *vt_create(int rows, int cols) {
+    if (rows < 1 || cols < 1) return NULL;
+    vt_t *vt = calloc(1, sizeof(*vt));
+    if (!vt) return NULL;
+    size_t n = (size_t)rows * (size_t)cols;
+    vt->main = malloc(n);
+    vt->alt  = malloc(n);
+    if (!vt->main || !vt->alt) {
+        vt_destroy(vt);
+        return NULL;
+    }
+    blank(vt->main, n);
+    blank(vt->alt, n);
+    vt->rows     = rows;
+    vt->cols     = cols;
+    vt->screen   = vt->main;
+    vt->autowrap = 1;
+    return vt;
+}
+
+// Copy of `cells` (rows x cols) into a new rows2 x cols2 grid, or NULL
+static char *regrid(const char *cells, int rows, int cols, int rows2, int cols2) {
+    char *grown = malloc((size_t)rows2 * (size_t)cols2);
+    if (!grown) return NULL;
+    blank(grown, (size_t)rows2 * (size_t)cols2);
+    for (int r = 0; r < rows && r < rows2; r++) {
+        memcpy(grown + (size_t)r * cols2, cells + (size_t)r * cols, (size_t)(cols < cols2 ? cols : cols2));
+    }
+    return grown;
+}
+
+int vt_resize(vt_t *vt, int rows, int cols) {
+    if (rows < 1 || cols < 1) return -1;
+    char *main = regrid(vt->main, vt->rows, vt->cols, rows, cols);
+    char *alt  = regrid(vt->alt, vt->rows, vt->cols, rows, cols);
+    if (!main || !alt) {
+        free(main);
+        free(alt);
+        return -1;
+    }
+    int on_alt = vt->screen == vt->alt;
+    free(vt->main);
+    free(vt->alt);
+    vt->main   = main;
+    vt->alt    = alt;
+    vt->screen = on_alt ? alt : main;
+    vt->rows   = rows;
+    vt->cols   = cols;
+    if (vt->row >= rows) vt->row = rows - 1;
+    if (vt->col >= cols) vt->col = cols - 1;
+    vt->wrap_pending = 0;
+    return 0;
+}
+
+int vt_rows(const vt_t *vt) {
+    return vt->rows;
+}
+
+int vt_cols(const vt_t *vt) {
+    return vt->cols;
+}
+
+static char *cell(vt_t *vt, int row, int col) {
+    return vt->screen + (size_t)row * vt->cols + col;
+}
+
+static void move_to(vt_t *vt, int row, int col) {
+    vt->row = row < 0 ? 0 : row >= vt->rows ? vt->rows - 1 : row;
+    vt->col = col < 0 ? 0 : col >= vt->cols ? vt->cols - 1 : col;
+    vt->wrap_pending = 0;
+}
+
+// Move down a row, scrolling the screen up at the bottom
+static void index_down(vt_t *vt) {
+    if (vt->row < vt->rows - 1) {
+        vt->row++;
+        return;
+    }
+    size_t line = (size_t)vt->cols;
+    memmove(vt->screen, vt->screen + line, (size_t)(vt->rows - 1) * line);
+    blank(vt->screen + (size_t)(vt->rows - 1) * line, line);
+    vt->stats.scrolls++;
+}
+
+static void index_up(vt_t *vt) {
+    if (vt->row > 0) {
+        vt->row--;
+        return;
+    }
+    size_t line = (size_t)vt->cols;
+    memmove(vt->screen + line, vt->screen, (size_t)(vt->rows - 1) * line);
+    blank(vt->screen, line);
+}
+
+static void put(vt_t *vt, char c) {
+    if (vt->wrap_pending) {
+        vt->col = 0;
+        vt->wrap_pending = 0;
+        index_down(vt);
+    }
+    *cell(vt, vt->row, vt->col) = c;
+    if (vt->col < vt->cols - 1) {
+        vt->col++;
+    } else if (vt->autowrap) {
+        vt->wrap_pending = 1;
+    }
+}
+
+// Erase cells [from, to) of the screen, counted from the top left
+static void erase(vt_t *vt, size_t from, size_t to) {
+    if (to > from) blank(vt->screen + from, to - from);
+}
+
+static int param(const vt_t *vt, int i, int fallback) {
+    return i < vt->nparams && vt->params[i] > 0 ? vt->params[i] : fallback;
+}
+
+// DEC private modes (CSI ? Pm h / l); returns 0 if the mode is not modeled
+static int set_mode(vt_t *vt, int mode, int on) {
+    size_t n = (size_t)vt->rows * (size_t)vt->cols;
+    switch (mode) {
+    case 7:
+        vt->autowrap = on;
+        return 1;
+    case 1049:  // alternate screen, cleared on entry, with the cursor saved around it
+    case 1047:
+    case 47:
+        if (on && vt->screen != vt->alt) {
+            vt->saved_row = vt->row;
+            vt->saved_col = vt->col;
+            vt->screen = vt->alt;
+            if (mode != 47) blank(vt->alt, n);
+        } else if (!on && vt->screen == vt->alt) {
+            vt->screen = vt->main;
+            if (mode == 1049) move_to(vt, vt->saved_row, vt->saved_col);
+        }
+        return 1;
+    case 25:    // cursor visibility
+    case 2026:  // synchronized output: the grid is only looked at between frames
+    case 1:     // application cursor keys
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int csi_dispatch(vt_t *vt, char final) {
+    size_t at   = (size_t)vt->row * vt->cols + vt->col;
+    size_t line = (size_t)vt->row * vt->cols;
+    size_t all  = (size_t)vt->rows * vt->cols;
+    if (vt->marker == '?') {
+        if ((final != 'h' && final != 'l') || vt->inter) return vt->inter == '$' && final == 'p';
+        int known = 1;
+        for (int i = 0; i < (vt->nparams ? vt->nparams : 1); i++) {
+            known &= set_mode(vt, vt->params[i], final == 'h');
+        }
+        return known;
+    }
+    if (vt->marker || vt->inter) return final == 'c';  // device attribute queries
+    switch (final) {
+    case 'H':
+    case 'f': move_to(vt, param(vt, 0, 1) - 1, param(vt, 1, 1) - 1); return 1;
+    case 'A': move_to(vt, vt->row - param(vt, 0, 1), vt->col); return 1;
+    case 'B': move_to(vt, vt->row + param(vt, 0, 1), vt->col); return 1;
+    case 'C': move_to(vt, vt->row, vt->col + param(vt, 0, 1)); return 1;
+    case 'D': move_to(vt, vt->row, vt->col - param(vt, 0, 1)); return 1;
+    case 'E': move_to(vt, vt->row + param(vt, 0, 1), 0); return 1;
+    case 'F': move_to(vt, vt->row - param(vt, 0, 1), 0); return 1;
+    case 'G': move_to(vt, vt->row, param(vt, 0, 1) - 1); return 1;
+    case 'd': move_to(vt, param(vt, 0, 1) - 1, vt->col); return 1;
+    case 'J':
+        switch (param(vt, 0, 0)) {
+        case 0: erase(vt, at, all); return 1;
+        case 1: erase(vt, 0, at + 1); return 1;
+        case 2:
+        case 3: erase(vt, 0, all); return 1;
+        default: return 0;
+        }
+    case 'K':
+        switch (param(vt, 0, 0)) {
+        case 0: erase(vt, at, line + vt->cols); return 1;
+        case 1: erase(vt, line, at + 1); return 1;
+        case 2: erase(vt, line, line + vt->cols); return 1;
+        default: return 0;
+        }
+    case 'm':  // colors and attributes: the grid holds characters only
+    case 'c':
+    case 'n':
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int esc_dispatch(vt_t *vt, char final) {
+    if (vt->inter) return vt->inter == '(' || vt->inter == ')';  // character set selection
+    switch (final) {
+    case '7':
+        vt->saved_row = vt->row;
+        vt->saved_col = vt->col;
+        return 1;
+    case '8': move_to(vt, vt->saved_row, vt->saved_col); return 1;
+    case 'D': vt->wrap_pending = 0; index_down(vt); return 1;
+    case 'E': vt->col = 0; vt->wrap_pending = 0; index_down(vt); return 1;
+    case 'M': vt->wrap_pending = 0; index_up(vt); return 1;
+    case 'c':
+        blank(vt->main, (size_t)vt->rows * vt->cols);
+        blank(vt->alt, (size_t)vt->rows * vt->cols);
+        vt->screen   = vt->main;
+        vt->autowrap = 1;
+        move_to(vt, 0, 0);
+        return 1;
+    case '=':
+    case '>':
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void control(vt_t *vt, unsigned char c) {
+    switch (c) {
+    case '\n':
+    case '\v':
+    case '\f':
+        vt->col = 0;
+        vt->wrap_pending = 0;
+        index_down(vt);
+        break;
+    case '\r':
+        vt->col = 0;
+        vt->wrap_pending = 0;
+        break;
+    case '\b':
+        if (vt->col > 0) vt->col--;
+        vt->wrap_pending = 0;
+        break;
+    case '\t':
+        move_to(vt, vt->row, (vt->col / TAB_STOP + 1) * TAB_STOP);
+        break;
+    default:  // BEL and the rest have no effect on the grid
+        break;
+    }
+}
+
+static void begin_sequence(vt_t *vt, int state) {
+    vt->state   = state;
+    vt->nparams = 0;
+    vt->marker  = 0;
+    vt->inter   = 0;
+}
+
+void vt_write(vt_t *vt, const void *data, size_t len) {
+    const unsigned char *p = data;
+    vt->stats.bytes += len;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = p[i];
+        switch (vt->state) {
+        case GROUND:
+            if (c == 0x1b) {
+                vt->stats.escapes++;
+                begin_sequence(vt, ESCAPE);
+            } else if (c < 0x20 || c == 0x7f) {
+                control(vt, c);
+            } else if (c < 0x80 || c >= 0xc0) {  // one cell per character, not per UTF-8 byte
+                put(vt, c < 0x80 ? (char)c : '?');
+            }
+            break;
+        case ESCAPE:
+            if (c == '[') {
+                vt->state = CSI;
+            } else if (c == ']' || c == 'P' || c == '_' || c == '^' || c == 'X') {
+                vt->state = STRING;  // OSC, DCS and the like: skipped to their terminator
+            } else if (c >= 0x20 && c <= 0x2f) {
+                vt->inter = (char)c;
+                vt->state = ESCAPE_INTER;
+            } else {
+                if (!esc_dispatch(vt, (char)c)) vt->stats.unknown++;
+                vt->state = GROUND;
+            }
+            break;
+        case ESCAPE_INTER:
+            if (c >= 0x20 && c <= 0x2f) {
+                vt->inter = (char)c;
+            } else {
+                if (!esc_dispatch(vt, (char)c)) vt->stats.unknown++;
+                vt->state = GROUND;
+            }
+            break;
+        case CSI:
+            if (c >= '0' && c <= '9') {
+                if (vt->nparams == 0) vt->params[vt->nparams++] = 0;
+                int *v = &vt->params[vt->nparams - 1];
+                if (*v < 100000) *v = *v * 10 + (c - '0');
+            } else if (c == ';') {
+                if (vt->nparams == 0) vt->params[vt->nparams++] = 0;
+                if (vt->nparams < MAX_PARAMS) vt->params[vt->nparams++] = 0;
+            } else if (c >= 0x3c && c <= 0x3f) {
+                vt->marker = (char)c;
+            } else if (c >= 0x20 && c <= 0x2f) {
+                vt->inter = (char)c;
+            } else if (c >= 0x40 && c <= 0x7e) {
+                if (!csi_dispatch(vt, (char)c)) vt->stats.unknown++;
+                vt->state = GROUND;
+            } else if (c < 0x20) {
+                control(vt, c);  // C0 controls take effect inside a sequence too
+            }
+            break;
+        case STRING:
+            if (c == 0x07) vt->state = GROUND;
+            else if (c == 0x1b) vt->state = STRING_ESC;
+            break;
+        case STRING_ESC:  // ST is ESC backslash
+            vt->state = c == '\\' ? GROUND : STRING;
+            break;
+        }
+    }
+}
+
+vt_stats_t vt_stats(const vt_t *vt) {
+    return vt->stats;
+}
+
+int vt_compare(const vt_t *vt, const char *text, size_t len) {
+    const char *end = text + len;
+    for (int r = 0; r < vt->rows; r++) {
+        const char *row = vt->screen + (size_t)r * vt->cols;
+        const char *nl  = text < end ? memchr(text, '\n', (size_t)(end - text)) : NULL;
+        size_t n = text < end ? (size_t)((nl ? nl : end) - text) : 0;
+        if (n > (size_t)vt->cols || memcmp(row, text, n) != 0) return r + 1;
+        for (size_t c = n; c < (size_t)vt->cols; c++) {
+            if (row[c] != ' ') return r + 1;
+        }
+        text = nl ? nl + 1 : end;
+    }
+    return text < end ? vt->rows + 1 : 0;  // lines left over that do not fit
+}
+
+void vt_destroy(vt_t *vt) {
+    if (!vt) return;
+    free(vt->main);
+    free(vt->alt);
+    free(vt);
+}
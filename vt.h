@@ -0,0 +1,54 @@
+#ifndef VT_H
+#define VT_H
+
+#include <stddef.h>
+
+// Minimal in-memory terminal, for checking what playback puts on screen.
+//
+// Bytes written to a terminal are applied to a character grid the way a
+// VT100/xterm-style terminal would apply them, covering everything playback
+// sends: printable characters with autowrap, CR, LF (as CR LF, the way the
+// tty driver passes a program's "\n" on), backspace and tab, cursor
+// positioning and movement, erasing in display and line, and the alternate
+// screen. Other control sequences (SGR colors, cursor visibility,
+// synchronized output, queries) are parsed and otherwise ignored. The grid
+// scrolls when a line feed reaches the bottom row.
+//
+// Every byte and every escape sequence is counted, so that the cost of a
+// frame on the wire can be measured alongside whether it drew correctly.
+
+typedef struct vt vt_t;
+
+typedef struct {
+    size_t bytes;     // bytes applied
+    size_t escapes;   // escape sequences (ESC or CSI introduced)
+    size_t unknown;   // of those, sequences the grid does not model
+    size_t scrolls;   // lines scrolled off the top
+} vt_stats_t;
+
+// A blank `rows` x `cols` grid with the cursor at the top left. Returns NULL
+// if out of memory.
+vt_t *vt_create(int rows, int cols);
+
+// Resize the grid, keeping what fits (as a terminal window being resized).
+// Returns 0, or -1 if out of memory (the grid is then unchanged).
+int vt_resize(vt_t *vt, int rows, int cols);
+
+int vt_rows(const vt_t *vt);
+int vt_cols(const vt_t *vt);
+
+// Apply `len` bytes of output. A sequence split across calls is carried over.
+void vt_write(vt_t *vt, const void *data, size_t len);
+
+// Totals since the grid was created
+vt_stats_t vt_stats(const vt_t *vt);
+
+// Compare the screen with `text` (`len` bytes, one '\n'-terminated line per
+// row, the last '\n' optional): each line must be on the row of the same
+// number from the top, and every other cell blank. Returns 0 if they match,
+// or the 1-based row of the first difference.
+int vt_compare(const vt_t *vt, const char *text, size_t len);
+
+void vt_destroy(vt_t *vt);
+
+#endif // VT_H